@@ -0,0 +1,130 @@
+#ifndef OPT_GPPC_ASTAR_SEARCH_HXX
+#define OPT_GPPC_ASTAR_SEARCH_HXX
+
+#include <vector>
+#include <utility>
+#include <ostream>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+#include "Heuristic.hxx"
+
+namespace baseline
+{
+
+struct AStarNode
+{
+	uint32_t g = Node::INV;
+	uint32_t pred = Node::NO_PRED;
+	bool closed = false;
+};
+
+/**
+ * Optimal A* over the live map with a consistent Heuristic, see Heuristic.hxx.
+ * Search nodes come from a generation stamped pool, so a query only touches the nodes it generates.
+ * Neighbourhoods are read from the Cells policy of BasicGrid and the pool is indexed by the Ids layout,
+ * AStarSearch uses the storage Grid picks, the layout of GPPC_NODE_LAYOUT and the landmarks of GPPC_LANDMARKS.
+ */
+template <typename Cells, typename Ids = RowMajorIds, typename Heuristic = OctileHeuristic>
+struct BasicAStarSearch : BasicGrid<Cells, Ids>
+{
+	using GridType = BasicGrid<Cells, Ids>;
+	using GridType::get;
+	using GridType::pack;
+	using GridType::unpack;
+	using GridType::size;
+
+	BasicAStarSearch(gppc_patch map) : GridType(map), heuristic(map)
+	{
+		pool.resize(size());
+	}
+	// for heuristics with an index, read from index_file when it matches the map
+	template <typename H = Heuristic, typename = decltype(H(std::declval<gppc_patch>(), std::declval<const char*>()))>
+	BasicAStarSearch(gppc_patch map, const char* index_file) : GridType(map), heuristic(map, index_file)
+	{
+		pool.resize(size());
+	}
+	template <typename H = Heuristic>
+	auto save_index(const char* filename) const -> decltype(std::declval<const H&>().save_index(filename))
+	{
+		return heuristic.save_index(filename);
+	}
+	template <typename H = Heuristic>
+	auto print_stats(std::ostream& out) const -> decltype(std::declval<const H&>().print_stats(out))
+	{
+		heuristic.print_stats(out);
+	}
+	// searches the live map, only the storage copy and the heuristic follow the changes
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		this->storage.update(this->cells, changes, changes_length);
+		heuristic.update(this->cells, changes, changes_length);
+	}
+	std::vector<gppc_point> path;
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		path.clear();
+		expanded = 0;
+		if (!get(s) || !get(g))
+			return false;
+		if (s == g) {
+			// zero path case
+			path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		uint32_t start = pack(s), goal = pack(g);
+		heuristic.set_goal(g);
+		pool.next_search();
+		open.clear();
+		pool[start].g = 0;
+		open.push(open_key(heuristic(s), 0), start);
+		while (!open.empty()) {
+			uint32_t id = open.pop().second;
+			AStarNode& node = pool[id];
+			if (node.closed)
+				continue; // stale entry
+			if (id == goal) {
+				for (uint32_t at = goal; at != Node::NO_PRED; at = pool[at].pred) {
+					Point p = unpack(at);
+					path.push_back(gppc_point{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)});
+				}
+				std::reverse(path.begin(), path.end());
+				return true;
+			}
+			node.closed = true;
+			expanded++;
+			uint32_t cost = node.g;
+			for_each_successor(*this, id, [this,id,cost](uint32_t succ, uint32_t edge_cost) {
+				AStarNode& S = pool[succ];
+				if (cost + edge_cost < S.g) {
+					S.g = cost + edge_cost;
+					S.pred = id;
+					open.push(open_key(S.g + heuristic(unpack(succ)), S.g), succ);
+				}
+			});
+		}
+		return false;
+	}
+
+	Heuristic heuristic;
+	NodePool<AStarNode> pool;
+	OpenList open;
+	size_t expanded = 0; // nodes expanded by the last search
+};
+#if defined(GPPC_LANDMARKS) && GPPC_LANDMARKS > 0
+using AStarHeuristic = DifferentialHeuristic<GPPC_LANDMARKS>;
+#else
+using AStarHeuristic = OctileHeuristic;
+#endif
+#if defined(GPPC_NODE_LAYOUT_TILED)
+using AStarSearch = BasicAStarSearch<Grid::cells_type, TiledIds, AStarHeuristic>;
+#else
+using AStarSearch = BasicAStarSearch<Grid::cells_type, RowMajorIds, AStarHeuristic>;
+#endif
+
+} // namespace baseline
+
+#endif
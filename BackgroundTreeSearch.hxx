@@ -0,0 +1,239 @@
+#ifndef OPT_GPPC_BACKGROUND_TREE_SEARCH_HXX
+#define OPT_GPPC_BACKGROUND_TREE_SEARCH_HXX
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <ostream>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "AStarSearch.hxx"
+
+namespace baseline
+{
+
+/**
+ * Spanning trees grown on a private copy of the map.
+ * The harness patches the live map between calls, so the copy is taken on the calling thread and
+ * the trees can then be grown on another thread without reading the live map.
+ */
+struct TreeBuffer : Grid
+{
+	TreeBuffer(gppc_patch map) : Grid(map), bits(map.bitarray, map.bitarray + (size() + 7) / 8)
+	{
+		cells.bitarray = bits.data();
+		storage.load(cells);
+	}
+	TreeBuffer(const TreeBuffer&) = delete;
+	TreeBuffer& operator=(const TreeBuffer&) = delete;
+	void copy_map(const uint8_t* live, uint64_t map_version)
+	{
+		std::copy(live, live + bits.size(), bits.begin());
+		storage.load(cells);
+		version = map_version;
+	}
+	void rebuild()
+	{
+		setup_grid(*this, queue);
+	}
+
+	std::vector<uint8_t> bits;
+	DijkstraQueue queue;
+	uint64_t version = 0; // map change the trees were grown for
+};
+
+/**
+ * SpanningTreeSearch trees rebuilt on a worker thread into a second buffer.
+ * A map change copies the live map into a snapshot and wakes the worker, it never waits: a worker still
+ * busy with an older snapshot finishes it and then rebuilds from the latest one.
+ * A query swaps the buffers once the worker is done with trees of the current map, trees of an outdated
+ * map are never swapped in. Until then a query walks the active trees and keeps the path if every step
+ * is still valid on the live map, otherwise it falls back to A* on the live map, so a query made while
+ * the rebuild runs is answered by the trees only if they are ready in time.
+ */
+struct BackgroundTreeSearch
+{
+	BackgroundTreeSearch(gppc_patch map) : live(map), shadow(map), snapshot((live.size() + 7) / 8)
+	{
+		trees[0].reset(new TreeBuffer(map));
+		trees[1].reset(new TreeBuffer(map));
+		trees[0]->rebuild();
+		worker = std::thread([this] { work(); });
+	}
+	~BackgroundTreeSearch()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_one();
+		worker.join();
+	}
+	BackgroundTreeSearch(const BackgroundTreeSearch&) = delete;
+	BackgroundTreeSearch& operator=(const BackgroundTreeSearch&) = delete;
+
+	// the live map already holds the changes, unless they flipped nothing the fallback syncs its cell
+	// storage and a rebuild is queued
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		if (!shadow.diff(live.cells, changes, changes_length))
+			return;
+		live.update_grid(changes, changes_length);
+		map_version++;
+		rebuilds++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::copy(live.cells.bitarray, live.cells.bitarray + snapshot.size(), snapshot.begin());
+			snapshot_version = map_version;
+			requested = true;
+		}
+		wake.notify_one();
+	}
+
+	bool turning_points = false; // only return the cells where the path turns
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		poll();
+		path.clear();
+		if (!live.get(s) || !live.get(g))
+			return false;
+		if (s == g) {
+			// zero path case
+			path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		uint32_t start = live.pack(s), goal = live.pack(g);
+		TreeBuffer& T = *trees[active];
+		if (T.version == map_version) {
+			tree_queries++;
+			if (!T.components.connected(start, goal))
+				return false;
+			walk_tree(T, start, goal);
+			emit_cells();
+			return true;
+		}
+		if (T.components.connected(start, goal) && walk_tree(T, start, goal) && valid_on_live()) {
+			stale_queries++;
+			emit_cells();
+			return true;
+		}
+		fallback_queries++;
+		if (!live.search(s, g))
+			return false;
+		for (const gppc_point& p : live.get_path())
+			push_path_point(path, Point(p.x, p.y), turning_points);
+		return true;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "background_rebuilds " << rebuilds << '\n'
+		    << "background_swaps " << swaps << '\n'
+		    << "background_tree_queries " << tree_queries << '\n'
+		    << "background_stale_queries " << stale_queries << '\n'
+		    << "background_fallback_queries " << fallback_queries << '\n';
+	}
+
+protected:
+	// swaps in the inactive trees if the worker is done with them and they are of the current map
+	void poll()
+	{
+		if (trees[active]->version == map_version)
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!built || trees[active ^ 1]->version != map_version)
+			return; // still building, or built from a snapshot the map has since moved past
+		built = false;
+		active ^= 1;
+		swaps++;
+	}
+	// rebuilds the inactive buffer from the latest snapshot, the calling thread only reads it once built
+	void work()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [this] { return stop || requested; });
+			if (stop)
+				return;
+			requested = false;
+			built = false;
+			TreeBuffer& T = *trees[active ^ 1];
+			T.copy_map(snapshot.data(), snapshot_version);
+			lock.unlock();
+			T.rebuild();
+			lock.lock();
+			built = true;
+		}
+	}
+
+	// lists the tree path from start to goal in cells, false if they hang off different roots
+	bool walk_tree(const TreeBuffer& T, uint32_t start, uint32_t goal)
+	{
+		cells.clear(); goal_side.clear();
+		while (start != goal) {
+			uint32_t c0 = T.nodes[start].cost, c1 = T.nodes[goal].cost;
+			if (c0 == c1 && c0 == 0)
+				return false; // different roots
+			if (c1 > c0) {
+				goal_side.push_back(goal);
+				goal = T.nodes[goal].pred;
+			} else {
+				cells.push_back(start);
+				start = T.nodes[start].pred;
+			}
+		}
+		cells.push_back(start);
+		cells.insert(cells.end(), goal_side.rbegin(), goal_side.rend());
+		return true;
+	}
+	// true if the walked cells are a valid path on the live map
+	bool valid_on_live() const
+	{
+		if (!live.get_unbound(cells.front()))
+			return false;
+		for (size_t i = 1; i < cells.size(); ++i) {
+			if (!valid_edge(live, cells[i-1], cells[i]))
+				return false;
+		}
+		return true;
+	}
+	void emit_cells()
+	{
+		for (uint32_t id : cells)
+			push_path_point(path, live.unpack(id), turning_points);
+	}
+
+	BasicAStarSearch<Grid::cells_type> live; // fallback, reads the live map, its ids are the trees' ids
+	ShadowMap shadow; // live map as of the last change
+	std::array<std::unique_ptr<TreeBuffer>, 2> trees;
+	uint32_t active = 0; // buffer answering queries, only changed by poll under the lock
+	uint64_t map_version = 0;
+	std::vector<gppc_point> path;
+	std::vector<uint32_t> cells, goal_side; // walk scratch
+	// worker
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<uint8_t> snapshot; // live map as of the last change, for the worker
+	uint64_t snapshot_version = 0;
+	bool built = false; // inactive buffer holds finished trees, the worker is idle
+	bool requested = false;
+	bool stop = false;
+	// counters
+	size_t rebuilds = 0;
+	size_t swaps = 0;
+	size_t tree_queries = 0;
+	size_t stale_queries = 0;
+	size_t fallback_queries = 0;
+};
+
+} // namespace baseline
+
+#endif
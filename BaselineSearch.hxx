@@ -5,13 +5,18 @@
 #include <utility>
 #include <limits>
 #include <queue>
-#include <stack>
 #include <array>
-#include <memory_resource>
 #include <algorithm>
+#include <ostream>
 #include <cstdint>
 #include <cassert>
 #include "Entry.h"
+#include "RadixHeap.hxx"
+#include "ThreadPool.hxx"
+#include "IndexFile.hxx"
+#include "BitFlood.hxx"
+#include "GridStorage.hxx"
+#include "ShadowMap.hxx"
 
 namespace baseline
 {
@@ -32,26 +37,236 @@ struct Node
 	uint32_t pred;
 	uint32_t cost;
 };
-struct Grid
+/**
+ * Connected components of the open cells.
+ * Each cell holds a label, labels of merged components are joined with union-find.
+ * A component records its cell count and the root of its shortest path tree.
+ */
+struct Components
 {
-	size_t size() const noexcept { return cells_size; }
+	struct Set
+	{
+		uint32_t parent;
+		uint32_t size;
+		uint32_t root;
+	};
+	void clear(size_t cells)
+	{
+		label.assign(cells, uint32_t{Node::INV});
+		sets.clear();
+		live = 0;
+	}
+	uint32_t add(uint32_t root, uint32_t size)
+	{
+		uint32_t id = static_cast<uint32_t>(sets.size());
+		sets.push_back(Set{id, size, root});
+		live++;
+		return id;
+	}
+	uint32_t find(uint32_t set) noexcept
+	{
+		while (sets[set].parent != set) {
+			sets[set].parent = sets[sets[set].parent].parent;
+			set = sets[set].parent;
+		}
+		return set;
+	}
+	// component of cell, Node::INV if blocked
+	uint32_t of(uint32_t cell) noexcept
+	{
+		uint32_t l = label[cell];
+		return l == Node::INV ? l : find(l);
+	}
+	bool connected(uint32_t a, uint32_t b) noexcept
+	{
+		uint32_t c = of(a);
+		return c != Node::INV && c == of(b);
+	}
+	// takes cell out of its component
+	void remove(uint32_t cell) noexcept
+	{
+		uint32_t c = of(cell);
+		label[cell] = Node::INV;
+		if (--sets[c].size == 0)
+			live--;
+	}
+	// joins component other into keep
+	void unite(uint32_t keep, uint32_t other) noexcept
+	{
+		sets[other].parent = keep;
+		sets[keep].size += sets[other].size;
+		live--;
+	}
+	// drops dead sets and relabels cells with dense ids
+	void compact()
+	{
+		dense.assign(sets.size(), uint32_t{Node::INV});
+		kept.clear();
+		for (uint32_t& l : label) {
+			if (l == Node::INV)
+				continue;
+			uint32_t c = find(l);
+			if (dense[c] == Node::INV) {
+				dense[c] = static_cast<uint32_t>(kept.size());
+				kept.push_back(Set{dense[c], sets[c].size, sets[c].root});
+			}
+			l = dense[c];
+		}
+		sets.swap(kept);
+		live = static_cast<uint32_t>(sets.size());
+	}
+
+	MappedArray<uint32_t> label;
+	std::vector<Set> sets;
+	uint32_t live = 0; // sets that are representatives and hold cells
+
+private:
+	// compact scratch, kept between calls
+	std::vector<uint32_t> dense;
+	std::vector<Set> kept;
+};
+/**
+ * Working buffers of setup_grid and repair_grid.
+ * They live as long as the grid and are only cleared between calls, so once they have grown to the
+ * largest rebuild or repair seen, neither allocates.
+ */
+struct GridScratch
+{
+	struct Region
+	{
+		size_t begin, end; // range of attached
+		uint32_t set;
+	};
+	std::vector<Point> cluster;
+	std::vector<std::pair<size_t, uint32_t>> roots; // (cluster size, root)
+	std::vector<uint32_t> pending, stack, borders, attached;
+	std::vector<Region> regions;
+	std::vector<uint32_t> merged; // per component set, the set it was merged into, Node::INV if untouched
+	std::vector<uint32_t> bordering; // sets with a merged entry
+	std::vector<std::pair<uint32_t, uint32_t>> groups; // (merged root, set)
+};
+// successor steps in SUCCESSOR_TABLE order: N, E, S, W, NE, NW, SE, SW
+constexpr int32_t SUCCESSOR_DX[8] = {0, 1, 0, -1, 1, -1, 1, -1};
+constexpr int32_t SUCCESSOR_DY[8] = {-1, 0, 1, 0, -1, -1, 1, 1};
+
+/**
+ * Node id layouts, the Ids of BasicGrid, map cells to indices of the per-cell arrays.
+ * Each gives the id range size(), pack(x, y) and unpack(id), step(id, x, y, d) for the id of the
+ * neighbour in direction d of cell (x, y) = unpack(id), and get(map, id) for the cell of id in map.
+ */
+
+/**
+ * Row by row, id = y * width + x. Neighbours are a fixed offset apart, vertical ones a row away.
+ */
+struct RowMajorIds
+{
+	RowMajorIds(uint32_t width, uint32_t height) : width(width), count(width * height)
+	{
+		for (uint32_t d = 0; d < 8; ++d)
+			offsets[d] = SUCCESSOR_DY[d] * static_cast<int32_t>(width) + SUCCESSOR_DX[d];
+	}
+	size_t size() const noexcept { return count; }
+	uint32_t pack(uint32_t x, uint32_t y) const noexcept
+	{
+		return y * width + x;
+	}
+	Point unpack(uint32_t id) const noexcept
+	{
+		return Point(static_cast<int>(id % width), static_cast<int>(id / width));
+	}
+	uint32_t step(uint32_t id, uint32_t, uint32_t, uint32_t d) const noexcept
+	{
+		return static_cast<uint32_t>(static_cast<int32_t>(id) + offsets[d]);
+	}
+	bool get(gppc_patch map, uint32_t id) const noexcept
+	{
+		return gppc_patch_get(map, static_cast<int>(id));
+	}
+
+	uint32_t width;
+	uint32_t count;
+	std::array<int32_t, 8> offsets; // id steps to the successors, in SUCCESSOR_TABLE order
+};
+
+/**
+ * TILE x TILE blocks of cells stored contiguously, blocks row by row.
+ * A cell's 3x3 block mostly shares its tile, so an expansion touches a few cache lines of the node
+ * arrays instead of three rows a stride apart. Rows of tiles are padded to a power of two so pack
+ * and unpack are shifts and masks, ids in the padding are never packed and read as blocked.
+ */
+struct TiledIds
+{
+	static constexpr uint32_t TILE_SHIFT = 3;
+	static constexpr uint32_t TILE = 1u << TILE_SHIFT;
+	static constexpr uint32_t MASK = TILE - 1;
+
+	TiledIds(uint32_t width, uint32_t height) : width(width), height(height)
+	{
+		uint32_t tiles_wide = 1, tiles_high = (height + MASK) >> TILE_SHIFT;
+		row_shift = 2 * TILE_SHIFT;
+		while (tiles_wide * TILE < width) {
+			tiles_wide <<= 1;
+			row_shift++;
+		}
+		count = static_cast<size_t>(tiles_high) << row_shift;
+	}
+	size_t size() const noexcept { return count; }
+	uint32_t pack(uint32_t x, uint32_t y) const noexcept
+	{
+		return (y >> TILE_SHIFT) << row_shift | (x >> TILE_SHIFT) << (2 * TILE_SHIFT) | (y & MASK) << TILE_SHIFT | (x & MASK);
+	}
+	Point unpack(uint32_t id) const noexcept
+	{
+		uint32_t x = ((id >> (2 * TILE_SHIFT)) & ((1u << (row_shift - 2 * TILE_SHIFT)) - 1)) << TILE_SHIFT | (id & MASK);
+		uint32_t y = (id >> row_shift) << TILE_SHIFT | ((id >> TILE_SHIFT) & MASK);
+		return Point(static_cast<int>(x), static_cast<int>(y));
+	}
+	uint32_t step(uint32_t, uint32_t x, uint32_t y, uint32_t d) const noexcept
+	{
+		return pack(static_cast<uint32_t>(static_cast<int32_t>(x) + SUCCESSOR_DX[d]), static_cast<uint32_t>(static_cast<int32_t>(y) + SUCCESSOR_DY[d]));
+	}
+	bool get(gppc_patch map, uint32_t id) const noexcept
+	{
+		Point p = unpack(id);
+		return static_cast<uint32_t>(p.first) < width && static_cast<uint32_t>(p.second) < height
+		    && gppc_patch_get_xy(map, static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second));
+	}
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t row_shift; // log2 of the ids in a row of tiles
+	size_t count;
+};
+
+/**
+ * Map dimensions, the per-cell search state and the traversability in the layout of the Cells policy,
+ * see GridStorage.hxx. Grid picks the policy at configure time, GPPC_GRID_STORAGE in CMakeLists.txt.
+ * Per-cell arrays are indexed by the ids of the Ids layout, engines that take it as a parameter
+ * choose it with GPPC_NODE_LAYOUT.
+ */
+template <typename Cells, typename Ids = RowMajorIds>
+struct BasicGrid
+{
+	using cells_type = Cells;
+	using ids_type = Ids;
+	size_t size() const noexcept { return ids.size(); }
 	uint32_t pack(Point p) const noexcept
 	{
 		assert(static_cast<uint32_t>(p.first) < width && static_cast<uint32_t>(p.second) < height);
-		return static_cast<uint32_t>(p.second) * width + static_cast<uint32_t>(p.first);
+		return ids.pack(static_cast<uint32_t>(p.first), static_cast<uint32_t>(p.second));
 	}
 	Point unpack(uint32_t p) const noexcept
 	{
 		assert(width != 0 && p < size());
-		return Point(static_cast<int>(p % width), static_cast<int>(p / width));
+		return ids.unpack(p);
 	}
 	bool get_unbound(uint32_t p) const noexcept
 	{
-		return gppc_patch_get(cells, static_cast<int>(p));
+		return ids.get(cells, p);
 	}
 	bool get(uint32_t p) const noexcept
 	{
-		return p < size() && gppc_patch_get(cells, static_cast<int>(p));
+		return p < size() && ids.get(cells, p);
 	}
 	bool get(Point p) const noexcept
 	{
@@ -60,49 +275,168 @@ struct Grid
 			&& gppc_patch_get_xy(cells, p.first, p.second);
 	}
 
-	Grid(gppc_patch map) :
+	BasicGrid(gppc_patch map) :
 		 width(static_cast<uint32_t>(map.width))
 		,height(static_cast<uint32_t>(map.height))
 		,cells(map)
 		,cells_size(width * height)
+		,storage(map)
+		,ids(width, height)
 	{ }
 
 	uint32_t width;
 	uint32_t height;
 	gppc_patch cells;
 	uint32_t cells_size;
-	std::vector<Node> nodes;
+	MappedArray<Node> nodes;
+	Components components;
+	BitFlood flood; // cells left to flood_fill
+	GridScratch scratch;
+	Cells storage; // traversability for neighbourhood reads, update_grid keeps it in step with the patches
+	Ids ids;
 };
+#if defined(GPPC_GRID_STORAGE_BITARRAY)
+using Grid = BasicGrid<BitarrayCells>;
+#elif defined(GPPC_GRID_STORAGE_PADDED)
+using Grid = BasicGrid<PaddedMap>;
+#elif defined(GPPC_GRID_STORAGE_TILED)
+using Grid = BasicGrid<TiledCells>;
+#else
+using Grid = BasicGrid<ByteCells>; // fastest on the bundled maps, see bench_storage
+#endif
+
+// dijkstra queue of (dist, node-id), popped dists never decrease
+using DijkstraQueue = RadixHeap<uint32_t>;
 
 void path_to_root(const Grid& grid, Point start, std::vector<Point>& out);
-void setup_grid(Grid& grid);
+template <typename Queue>
+void setup_grid(Grid& grid, Queue& Q);
+template <typename Queue>
+void setup_grid(Grid& grid, ThreadPool& pool, std::vector<Queue>& queues);
+template <typename Queue>
+bool repair_grid(Grid& grid, Queue& Q, const std::vector<uint32_t>& opened, const std::vector<uint32_t>& closed, size_t flip_limit);
+bool write_tree_index(const Grid& grid, const char* filename);
+bool map_tree_index(Grid& grid, FileMapping& mapping, const char* filename);
+
+// appends p to path, with turning_points a p continuing the last segment's direction moves its end instead
+inline void push_path_point(std::vector<gppc_point>& path, Point p, bool turning_points)
+{
+	gppc_point q{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)};
+	size_t n = path.size();
+	if (turning_points && n >= 2) {
+		auto&& sign = [] (int d) { return (d > 0) - (d < 0); };
+		const gppc_point& a = path[n-2];
+		const gppc_point& b = path[n-1];
+		if (sign(b.x - a.x) == sign(q.x - b.x) && sign(b.y - a.y) == sign(q.y - b.y)) {
+			path.back() = q;
+			return;
+		}
+	}
+	path.push_back(q);
+}
+// joins the goal side of a tree walk, listed from the goal, onto path
+inline void append_reversed(std::vector<gppc_point>& path, const std::vector<gppc_point>& goal_side, bool turning_points)
+{
+	for (auto it = goal_side.rbegin(); it != goal_side.rend(); ++it)
+		push_path_point(path, Point(it->x, it->y), turning_points);
+}
+
+// a streamed query returns at least this many start side cells in its first part
+constexpr uint32_t STREAM_PREFIX = 32;
+
+// trees of separate clusters are grown on up to this many threads
+constexpr unsigned SETUP_THREADS = 4;
+inline unsigned setup_threads()
+{
+	return std::min(SETUP_THREADS, std::max(1u, std::thread::hardware_concurrency()));
+}
 
 struct SpanningTreeSearch : Grid
 {
-	SpanningTreeSearch(gppc_patch map) : Grid(map)
+	SpanningTreeSearch(gppc_patch map, unsigned threads = setup_threads())
+		: Grid(map), repair_limit(cells_size / 8), pool(threads), queues(pool.size()), shadow(map)
 	{
 		update_grid();
 	}
+	// adopts the trees from an index written by save_index, builds them if it is missing or stale
+	SpanningTreeSearch(gppc_patch map, const char* index_file, unsigned threads = setup_threads())
+		: Grid(map), repair_limit(cells_size / 8), pool(threads), queues(pool.size()), shadow(map)
+	{
+		if (!map_tree_index(*this, index, index_file))
+			update_grid();
+	}
+	bool save_index(const char* filename) const
+	{
+		return write_tree_index(*this, filename);
+	}
 	void update_grid()
 	{
-		setup_grid(*this);
+		setup_grid(*this, pool, queues);
+	}
+	// repairs the trees around the flipped cells, rebuilds everything if more than repair_limit flipped
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		streaming = false;
+		if (!shadow.diff(cells, changes, changes_length)) {
+			unchanged++;
+			return; // patches rewrote cells with their old values
+		}
+		storage.update(cells, changes, changes_length);
+		if (!repair_grid(*this, queues[0], shadow.opened, shadow.closed, repair_limit)) {
+			update_grid();
+			rebuilds++;
+		} else {
+			repairs++;
+			if (components.sets.size() > 2 * static_cast<size_t>(components.live) + 1024)
+				components.compact(); // splits and merges left mostly dead sets
+		}
+	}
+	void print_stats(std::ostream& out) const
+	{
+		out << "tree_repairs " << repairs << '\n'
+		    << "tree_rebuilds " << rebuilds << '\n'
+		    << "tree_unchanged " << unchanged << '\n';
+		shadow.print_stats(out);
 	}
+	size_t repair_limit;
+	FileMapping index; // copy-on-write, backs nodes and labels for the engine's whole lifetime, rebuilds refill it in place
+	ThreadPool pool;
+	std::vector<DijkstraQueue> queues; // scratch for each pool worker, kept between updates
+	ShadowMap shadow; // map as of the last change
+	// counters
+	size_t repairs = 0;
+	size_t rebuilds = 0;
+	size_t unchanged = 0; // changes that flipped no cell
 	std::array<std::vector<gppc_point>, 2> path_parts;
+	bool turning_points = false; // only return the cells where the path turns
+	bool stream_prefix = false; // return the start side below the goal first, see stream_start
 	const std::vector<gppc_point>& get_path() const noexcept { return path_parts[0]; }
-	// bool search found a path
+	// last returned path is a prefix, search must be called again with the same query
+	bool incomplete() const noexcept { return streaming; }
+	// bool search found a path, continues an incomplete query from where its prefix ended
 	bool search(Point s, Point g)
 	{
-		auto&& push_back = [](std::vector<gppc_point>& path, Point p) {
-			path.push_back(gppc_point{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)});
+		auto&& push_back = [this](std::vector<gppc_point>& path, Point p) {
+			push_path_point(path, p, turning_points);
 		};
 		std::array<uint32_t, 2> nodeid{{pack(s), pack(g)}};
-		if (nodes[nodeid[0]].pred == Node::INV || nodes[nodeid[1]].pred == Node::INV)
-			return false;
-		if (nodeid[0] == nodeid[1]) {
-			// zero path case
-			path_parts[0].assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second}, 
-				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
-			return true;
+		if (streaming && s == query_start && g == query_goal) {
+			nodeid[0] = resume_at;
+			streaming = false;
+		} else {
+			streaming = false;
+			if (!components.connected(nodeid[0], nodeid[1]))
+				return false;
+			if (nodeid[0] == nodeid[1]) {
+				// zero path case
+				path_parts[0].assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second}, 
+					gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+				return true;
+			}
+			if (stream_prefix && stream_start(nodeid[0], nodeid[1])) {
+				query_start = s; query_goal = g;
+				return true;
+			}
 		}
 		path_parts[0].clear(); path_parts[1].clear();
 		while (true) {
@@ -122,37 +456,47 @@ struct SpanningTreeSearch : Grid
 			push_back(path_parts[progressId], unpack(nodeid[progressId]));
 			nodeid[progressId] = nodes[nodeid[progressId]].pred;
 		}
-		path_parts[0].insert(path_parts[0].end(), path_parts[1].rbegin(), path_parts[1].rend());
+		append_reversed(path_parts[0], path_parts[1], turning_points);
+		return true;
+	}
+
+private:
+	/**
+	 * Returns the first STREAM_PREFIX cells from start as a prefix when they all cost more than goal.
+	 * Costs fall towards the root, so such cells lie below the common ancestor and are on the path
+	 * whatever the goal side looks like. Otherwise the query is left to the full walk.
+	 */
+	bool stream_start(uint32_t start, uint32_t goal)
+	{
+		uint32_t goal_cost = nodes[goal].cost;
+		path_parts[0].clear();
+		uint32_t at = start;
+		for (uint32_t i = 0; i < STREAM_PREFIX; ++i, at = nodes[at].pred) {
+			if (nodes[at].cost <= goal_cost)
+				return false;
+			push_path_point(path_parts[0], unpack(at), turning_points);
+		}
+		resume_at = at;
+		streaming = true;
 		return true;
 	}
+
+	// streamed query
+	Point query_start, query_goal;
+	uint32_t resume_at = 0; // first start side cell not yet returned
+	bool streaming = false;
 };
 
+// claims the cluster of origin from grid.flood, marks its cells FLOOD_FILL and lists them in out
 void flood_fill(Grid& grid, std::vector<Point>& out, uint32_t origin)
 {
 	assert(origin < grid.nodes.size() && grid.nodes[origin].pred == Node::INV);
 	out.clear();
-	std::stack<Point, std::vector<Point>> Q;
-	auto&& push_queue = [&grid,&Q] (Point p, int dx, int dy) {
-		p.first += dx; p.second += dy;
-		if (grid.get(p)) {
-			auto& node = grid.nodes[grid.pack(p)];
-			if (node.pred == Node::INV) {
-				node.pred = Node::FLOOD_FILL;
-				Q.push(p);
-			}
-		}
-	};
-	grid.nodes[origin].pred = Node::FLOOD_FILL;
-	Q.push(grid.unpack(origin));
-	while (!Q.empty())
-	{
-		Point p = Q.top(); Q.pop();
-		out.push_back(p);
-		push_queue(p, 1, 0);
-		push_queue(p, -1, 0);
-		push_queue(p, 0, 1);
-		push_queue(p, 0, -1);
-	}
+	Point p = grid.unpack(origin);
+	grid.flood.fill(static_cast<uint32_t>(p.first), static_cast<uint32_t>(p.second), [&grid,&out] (uint32_t x, uint32_t y) {
+		out.emplace_back(static_cast<int>(x), static_cast<int>(y));
+		grid.nodes[static_cast<size_t>(y) * grid.width + x].pred = Node::FLOOD_FILL;
+	});
 }
 
 enum class Compass : uint32_t
@@ -167,88 +511,441 @@ enum class Compass : uint32_t
 	SE = 0b100000000 | S | E,
 	SW = 0b001000000 | S | W,
 };
-void dijkstra(Grid& grid, uint32_t origin)
+// 1 if every cell of c is open in block
+constexpr uint32_t all_open(uint32_t block, Compass c)
+{
+	return (block & static_cast<uint32_t>(c)) == static_cast<uint32_t>(c) ? 1u : 0u;
+}
+// successor directions of the centre of a block3 mask (1 = trav), bit d in the order N, E, S, W, NE, NW, SE, SW
+constexpr uint8_t successor_dirs(uint32_t block)
+{
+	return static_cast<uint8_t>(all_open(block, Compass::N) | all_open(block, Compass::E) << 1
+		| all_open(block, Compass::S) << 2 | all_open(block, Compass::W) << 3
+		| all_open(block, Compass::NE) << 4 | all_open(block, Compass::NW) << 5
+		| all_open(block, Compass::SE) << 6 | all_open(block, Compass::SW) << 7);
+}
+#define GPPC_SUCC4(i) successor_dirs(i), successor_dirs(i+1), successor_dirs(i+2), successor_dirs(i+3)
+#define GPPC_SUCC16(i) GPPC_SUCC4(i), GPPC_SUCC4(i+4), GPPC_SUCC4(i+8), GPPC_SUCC4(i+12)
+#define GPPC_SUCC64(i) GPPC_SUCC16(i), GPPC_SUCC16(i+16), GPPC_SUCC16(i+32), GPPC_SUCC16(i+48)
+// successor directions for each of the 512 block3 masks, corner cutting already excluded
+constexpr uint8_t SUCCESSOR_TABLE[512] = {
+	GPPC_SUCC64(0), GPPC_SUCC64(64), GPPC_SUCC64(128), GPPC_SUCC64(192),
+	GPPC_SUCC64(256), GPPC_SUCC64(320), GPPC_SUCC64(384), GPPC_SUCC64(448)
+};
+#undef GPPC_SUCC64
+#undef GPPC_SUCC16
+#undef GPPC_SUCC4
+constexpr uint32_t SUCCESSOR_COST[8] = {COST_0, COST_0, COST_0, COST_0, COST_1, COST_1, COST_1, COST_1};
+
+// calls fn(succ, edge_cost) for each successor of node, corner cutting is not allowed
+template <typename GridT, typename Fn>
+void for_each_successor(const GridT& grid, uint32_t node, Fn&& fn)
+{
+	Point p = grid.unpack(node);
+	uint32_t x = static_cast<uint32_t>(p.first), y = static_cast<uint32_t>(p.second);
+	for (uint32_t dirs = SUCCESSOR_TABLE[grid.storage.block3(x, y)]; dirs != 0; dirs &= dirs - 1) {
+		uint32_t d = static_cast<uint32_t>(__builtin_ctz(dirs));
+		fn(grid.ids.step(node, x, y, d), SUCCESSOR_COST[d]);
+	}
+}
+
+// calls fn(neighbour) for each in-bounds cell of the 3x3 block around node, excluding node
+template <typename Fn>
+void for_each_neighbour(const Grid& grid, uint32_t node, Fn&& fn)
+{
+	Point p = grid.unpack(node);
+	for (int dy = -1; dy < 2; dy++)
+	for (int dx = -1; dx < 2; dx++) {
+		Point q(p.first + dx, p.second + dy);
+		if ((dx != 0 || dy != 0) && static_cast<uint32_t>(q.first) < grid.width && static_cast<uint32_t>(q.second) < grid.height)
+			fn(grid.pack(q));
+	}
+}
+
+// true if u (traversable) may move to its neighbour v
+template <typename GridT>
+bool valid_edge(const GridT& grid, uint32_t u, uint32_t v)
+{
+	Point a = grid.unpack(u), b = grid.unpack(v);
+	const auto& P = grid.storage;
+	if (!P.get(b.first, b.second))
+		return false;
+	if (a.first != b.first && a.second != b.second)
+		return P.get(b.first, a.second) && P.get(a.first, b.second);
+	return true;
+}
+
+// binary heap dijkstra queue, first = dist, second = node-id
+using BinaryHeapQueue = std::priority_queue<std::pair<uint32_t,uint32_t>, std::vector<std::pair<uint32_t,uint32_t>>, std::greater<std::pair<uint32_t,uint32_t>>>;
+
+// settles every node reachable from the queued nodes, which must already hold their cost
+template <typename GridT, typename Queue>
+void dijkstra_relax(GridT& grid, Queue& Q)
 {
-	// first = dist, second = node-id
-	using node_type = std::pair<uint32_t,uint32_t>;
-	std::priority_queue<node_type, std::vector<node_type>, std::greater<node_type>> Q;
-	auto try_push = [&grid,&Q](uint32_t node, int dx, int dy, uint32_t cost) {
-		uint32_t newNode = static_cast<uint32_t>( static_cast<int>(node) + dy * grid.width + dx );
-		Node& N = grid.nodes[newNode];
-		if (cost < N.cost) {
-			N.pred = node;
-			N.cost = cost;
-			Q.emplace(cost, newNode);
-		}
-	};
-	Q.emplace(0, origin);
-	grid.nodes[origin].cost = 0;
-	grid.nodes[origin].pred = Node::NO_PRED;
 	while (!Q.empty()) {
 		auto node_value = Q.top(); Q.pop();
 		auto cost = node_value.first;
 		auto node = node_value.second; 
 		if (cost != grid.nodes[node].cost)
 			continue; // skip
-		Point p = grid.unpack(node);
 		// push successors
-		uint32_t mask = 0;
-		for (int i = 0, dy = -1; dy < 2; dy++)
-		for (int dx = -1; dx < 2; dx++) {
-			mask |= static_cast<uint32_t>(grid.get( Point(p.first + dx, p.second + dy) )) << i++;
-		}
-		mask = ~mask; // 1 = non-trav, 0 = trav
-
-		// 012
-		// 345
-		// 678
-		// N
-		if ( (mask & static_cast<uint32_t>(Compass::N)) == 0 ) try_push(node, 0, -1, cost + COST_0);
-		// E
-		if ( (mask & static_cast<uint32_t>(Compass::E)) == 0 ) try_push(node, 1, 0, cost + COST_0);
-		// S
-		if ( (mask & static_cast<uint32_t>(Compass::S)) == 0 ) try_push(node, 0, 1, cost + COST_0);
-		// W
-		if ( (mask & static_cast<uint32_t>(Compass::W)) == 0 ) try_push(node, -1, 0, cost + COST_0);
-		// NE
-		if ( (mask & static_cast<uint32_t>(Compass::NE)) == 0 ) try_push(node, 1, -1, cost + COST_1);
-		// NW
-		if ( (mask & static_cast<uint32_t>(Compass::NW)) == 0 ) try_push(node, -1, -1, cost + COST_1);
-		// SE
-		if ( (mask & static_cast<uint32_t>(Compass::SE)) == 0 ) try_push(node, 1, 1, cost + COST_1);
-		// SW
-		if ( (mask & static_cast<uint32_t>(Compass::SW)) == 0 ) try_push(node, -1, 1, cost + COST_1);
+		for_each_successor(grid, node, [&grid,&Q,node,cost](uint32_t succ, uint32_t edge_cost) {
+			Node& N = grid.nodes[succ];
+			if (cost + edge_cost < N.cost) {
+				N.pred = node;
+				N.cost = cost + edge_cost;
+				Q.emplace(cost + edge_cost, succ);
+			}
+		});
 	}
 }
 
-void setup_grid(Grid& grid)
+template <typename GridT, typename Queue>
+void dijkstra(GridT& grid, Queue& Q, uint32_t origin)
+{
+	assert(Q.empty());
+	Q.emplace(0, origin);
+	grid.nodes[origin].cost = 0;
+	grid.nodes[origin].pred = Node::NO_PRED;
+	dijkstra_relax(grid, Q);
+}
+
+// cell of the cluster closest to its centre, ties go to the lowest cell id so the order of cluster does not matter
+uint32_t cluster_root(const Grid& grid, const std::vector<Point>& cluster)
 {
-	grid.nodes.assign(grid.size(), Node{Node::INV, Node::INV});
-	std::vector<Point> cluster;
 	struct Dist {
 		bool operator()(Point q, Point p) const noexcept {
-			return dist(q, centre) < dist(p, centre);
+			int dq = dist(q, centre), dp = dist(p, centre);
+			return dq < dp || (dq == dp && (q.second < p.second || (q.second == p.second && q.first < p.first)));
 		}
 		static int dist(Point q, Point p) noexcept {
 			return std::abs(q.first - p.first) + std::abs(q.second - p.second);
 		}
 		Point centre;
 	};
-	for (uint32_t i = 0, ie = grid.size(); i < ie; ++i) {
-		if (grid.get_unbound(i) && grid.nodes[i].pred == Node::INV) {
-			// new cluster
-			flood_fill(grid, cluster, i);
-			assert(!cluster.empty());
-			std::uint64_t sumx = 0, sumy = 0;
-			for (Point p : cluster) {
-				sumx += p.first; sumy += p.second;
+	assert(!cluster.empty());
+	std::uint64_t sumx = 0, sumy = 0;
+	for (Point p : cluster) {
+		sumx += p.first; sumy += p.second;
+	}
+	Point cluster_centre(static_cast<int>(sumx / cluster.size()), static_cast<int>(sumy / cluster.size()));
+	return grid.pack( *std::min_element(cluster.begin(), cluster.end(), Dist{cluster_centre}) );
+}
+
+// gives the flood filled cluster its own component rooted at root
+void label_cluster(Grid& grid, const std::vector<Point>& cluster, uint32_t root)
+{
+	uint32_t set = grid.components.add(root, static_cast<uint32_t>(cluster.size()));
+	for (Point p : cluster)
+		grid.components.label[grid.pack(p)] = set;
+}
+
+// labels the components of the open cells without growing trees, the sets have no root
+void label_components(Grid& grid)
+{
+	Components& C = grid.components;
+	C.clear(grid.size());
+	grid.flood.load(grid.cells);
+	for (uint32_t x, y; grid.flood.next(x, y); ) {
+		uint32_t set = C.add(uint32_t{Node::INV}, 0);
+		grid.flood.fill(x, y, [&grid,&C,set] (uint32_t mx, uint32_t my) {
+			C.label[static_cast<size_t>(my) * grid.width + mx] = set;
+			C.sets[set].size++;
+		});
+	}
+}
+
+// roots the flood filled cluster at the cell closest to its centre and grows its tree
+template <typename Queue>
+void grow_cluster(Grid& grid, Queue& Q, const std::vector<Point>& cluster)
+{
+	uint32_t root = cluster_root(grid, cluster);
+	label_cluster(grid, cluster, root);
+	dijkstra(grid, Q, root);
+	assert(std::all_of(cluster.begin(), cluster.end(), [&grid] (Point q) { return grid.nodes.at(grid.pack(q)).pred != Node::FLOOD_FILL; }));
+}
+
+template <typename Queue>
+void setup_grid(Grid& grid, Queue& Q)
+{
+	grid.nodes.assign(grid.size(), Node{Node::INV, Node::INV});
+	grid.components.clear(grid.size());
+	grid.flood.load(grid.cells);
+	std::vector<Point>& cluster = grid.scratch.cluster;
+	for (uint32_t x, y; grid.flood.next(x, y); ) {
+		// new cluster
+		flood_fill(grid, cluster, grid.pack(Point(x, y)));
+		grow_cluster(grid, Q, cluster);
+	}
+}
+
+// bumped whenever Node, Components::Set or the section order change
+constexpr uint32_t TREE_INDEX_VERSION = 1;
+
+// identifies the map an index was built for
+uint64_t map_key(gppc_patch map)
+{
+	uint32_t dims[2] = {map.width, map.height};
+	uint64_t h = hash_bytes(dims, sizeof(dims));
+	size_t cells = static_cast<size_t>(map.width) * map.height;
+	size_t full = cells / 8;
+	h = hash_bytes(map.bitarray, full, h);
+	if (uint32_t rest = cells % 8) {
+		unsigned char tail = map.bitarray[full] & static_cast<unsigned char>((1u << rest) - 1);
+		h = hash_bytes(&tail, 1, h);
+	}
+	return h;
+}
+uint64_t map_key(const Grid& grid)
+{
+	return map_key(grid.cells);
+}
+
+/**
+ * Writes grid.nodes, the component labels and sets as a versioned, checksummed index
+ * keyed to the current map.
+ */
+bool write_tree_index(const Grid& grid, const char* filename)
+{
+	const Components& C = grid.components;
+	return write_index(filename, TREE_INDEX_VERSION, map_key(grid), {
+		IndexSection{grid.nodes.data(), grid.nodes.size() * sizeof(Node)},
+		IndexSection{C.label.data(), C.label.size() * sizeof(uint32_t)},
+		IndexSection{C.sets.data(), C.sets.size() * sizeof(Components::Set)}
+	});
+}
+
+/**
+ * Maps an index written by write_tree_index for the current map.
+ * grid.nodes and the labels view the copy-on-write mapping, so repairs only copy the pages they touch.
+ * @return false and leaves grid untouched if the file is missing or does not match.
+ */
+bool map_tree_index(Grid& grid, FileMapping& mapping, const char* filename)
+{
+	std::vector<IndexSection> sections;
+	if (!map_index(mapping, filename, TREE_INDEX_VERSION, map_key(grid), sections))
+		return false;
+	if (sections.size() != 3 || sections[0].bytes != grid.size() * sizeof(Node) || sections[1].bytes != grid.size() * sizeof(uint32_t)
+		|| sections[2].bytes % sizeof(Components::Set) != 0) {
+		mapping.unmap();
+		return false;
+	}
+	// the mapping is private and writable
+	grid.nodes.adopt(static_cast<Node*>(const_cast<void*>(sections[0].data)), grid.size());
+	Components& C = grid.components;
+	C.label.adopt(static_cast<uint32_t*>(const_cast<void*>(sections[1].data)), grid.size());
+	const Components::Set* sets = static_cast<const Components::Set*>(sections[2].data);
+	C.sets.assign(sets, sets + sections[2].bytes / sizeof(Components::Set));
+	C.live = 0;
+	for (uint32_t s = 0; s < C.sets.size(); ++s) {
+		if (C.sets[s].parent == s && C.sets[s].size != 0)
+			C.live++;
+	}
+	return true;
+}
+
+/**
+ * setup_grid with the trees grown concurrently.
+ * Clusters are labelled and rooted first, then each cluster dijkstra runs as a pool task with the
+ * queue of its worker, largest clusters first. A dijkstra only writes the nodes of its own cluster,
+ * so the trees are the same as the serial setup_grid regardless of scheduling.
+ */
+template <typename Queue>
+void setup_grid(Grid& grid, ThreadPool& pool, std::vector<Queue>& queues)
+{
+	grid.nodes.assign(grid.size(), Node{Node::INV, Node::INV});
+	grid.components.clear(grid.size());
+	grid.flood.load(grid.cells);
+	std::vector<Point>& cluster = grid.scratch.cluster;
+	std::vector<std::pair<size_t, uint32_t>>& roots = grid.scratch.roots; // (cluster size, root)
+	roots.clear();
+	for (uint32_t x, y; grid.flood.next(x, y); ) {
+		flood_fill(grid, cluster, grid.pack(Point(x, y)));
+		roots.emplace_back(cluster.size(), cluster_root(grid, cluster));
+		label_cluster(grid, cluster, roots.back().second);
+	}
+	std::sort(roots.begin(), roots.end(), [] (std::pair<size_t, uint32_t> a, std::pair<size_t, uint32_t> b) {
+		return a.first > b.first || (a.first == b.first && a.second < b.second);
+	});
+	queues.resize(pool.size());
+	pool.run(roots.size(), [&grid,&queues,&roots] (size_t task, unsigned worker) {
+		dijkstra(grid, queues[worker], roots[task].second);
+	});
+}
+
+/**
+ * Repairs the shortest path trees in grid.nodes after the cells in opened and closed flipped,
+ * see ShadowMap::diff. Closed cells orphan the subtrees hanging off them, opened cells join them into the pending set.
+ * Each connected pending region is either reattached to the trees bordering it (merging those trees
+ * into the largest one), or becomes a new cluster when nothing borders it.
+ * grid.components follows along: removed cells leave their component, a region that splits off gets
+ * a new one, and components joined through a region are united.
+ * A dijkstra seeded from the tree nodes bordering the pending regions then settles every pending cell
+ * and relaxes any shortcut the opened cells introduced.
+ * @return false if more than flip_limit cells flipped, grid is left untouched and must be rebuilt.
+ */
+template <typename Queue>
+bool repair_grid(Grid& grid, Queue& Q, const std::vector<uint32_t>& opened, const std::vector<uint32_t>& closed, size_t flip_limit)
+{
+	if (opened.size() + closed.size() > flip_limit)
+		return false;
+
+	auto&& in_tree = [&grid] (uint32_t id) {
+		uint32_t pred = grid.nodes[id].pred;
+		return pred != Node::INV && pred != Node::FLOOD_FILL;
+	};
+	GridScratch& S = grid.scratch;
+	// closed cells leave the trees right away, opened cells are pending and marked FLOOD_FILL
+	std::vector<uint32_t>& pending = S.pending;
+	pending.clear();
+	for (uint32_t id : opened) {
+		assert(grid.nodes[id].pred == Node::INV);
+		grid.nodes[id].pred = Node::FLOOD_FILL;
+		pending.push_back(id);
+	}
+	for (uint32_t id : closed) {
+		assert(grid.nodes[id].pred != Node::INV);
+		grid.nodes[id] = Node{Node::INV, Node::INV};
+		grid.components.remove(id);
+	}
+	// orphan every subtree whose edge to its pred runs through a closed cell
+	std::vector<uint32_t>& stack = S.stack;
+	stack.clear();
+	for (uint32_t c : closed) {
+		for_each_neighbour(grid, c, [&] (uint32_t v) {
+			if (!in_tree(v) || grid.nodes[v].pred == Node::NO_PRED || valid_edge(grid, v, grid.nodes[v].pred))
+				return;
+			grid.nodes[v] = Node{Node::INV, Node::INV};
+			stack.push_back(v);
+			while (!stack.empty()) {
+				uint32_t u = stack.back(); stack.pop_back();
+				grid.components.remove(u);
+				pending.push_back(u);
+				for_each_neighbour(grid, u, [&] (uint32_t w) {
+					if (grid.nodes[w].pred == u) {
+						grid.nodes[w] = Node{Node::INV, Node::INV};
+						stack.push_back(w);
+					}
+				});
+			}
+		});
+	}
+	if (pending.empty())
+		return true;
+	grid.flood.reset(grid.width, grid.height);
+	for (uint32_t id : pending) {
+		grid.nodes[id] = Node{Node::INV, Node::INV};
+		Point p = grid.unpack(id);
+		grid.flood.set(static_cast<uint32_t>(p.first), static_cast<uint32_t>(p.second));
+	}
+
+	// group pending cells into regions and find the components bordering them
+	std::vector<GridScratch::Region>& regions = S.regions;
+	regions.clear();
+	S.merged.assign(grid.components.sets.size(), uint32_t{Node::INV});
+	S.bordering.clear();
+	auto&& find_merged = [&S] (uint32_t root) {
+		while (true) {
+			if (root >= S.merged.size())
+				S.merged.resize(root + 1, uint32_t{Node::INV}); // set of a region grown meanwhile
+			uint32_t& up = S.merged[root];
+			if (up == Node::INV) {
+				up = root;
+				S.bordering.push_back(root);
+			}
+			if (up == root)
+				return root;
+			root = up;
+		}
+	};
+	std::vector<Point>& cluster = S.cluster;
+	std::vector<uint32_t>& borders = S.borders;
+	std::vector<uint32_t>& attached = S.attached;
+	attached.clear();
+	for (uint32_t id : pending) {
+		if (grid.nodes[id].pred != Node::INV)
+			continue; // already in a region
+		flood_fill(grid, cluster, id);
+		borders.clear();
+		for (Point p : cluster) {
+			const Point adj[4] = {{p.first, p.second-1}, {p.first+1, p.second}, {p.first, p.second+1}, {p.first-1, p.second}};
+			for (Point q : adj) {
+				if (grid.storage.get(q.first, q.second) && in_tree(grid.pack(q)))
+					borders.push_back(grid.components.of(grid.pack(q)));
+			}
+		}
+		if (borders.empty()) {
+			// disconnected from every tree, becomes its own cluster
+			grow_cluster(grid, Q, cluster);
+			continue;
+		}
+		regions.push_back(GridScratch::Region{attached.size(), attached.size() + cluster.size(), borders.front()});
+		for (Point p : cluster)
+			attached.push_back(grid.pack(p));
+		uint32_t root = find_merged(borders.front());
+		for (uint32_t b : borders) {
+			b = find_merged(b);
+			if (b != root)
+				S.merged[b] = root;
+		}
+	}
+	if (attached.empty())
+		return true;
+
+	// components joined through a region keep the largest tree, the others are cleared and regrown from it
+	std::vector<std::pair<uint32_t, uint32_t>>& groups = S.groups;
+	groups.clear();
+	for (uint32_t set : S.bordering)
+		groups.emplace_back(find_merged(set), set);
+	std::sort(groups.begin(), groups.end());
+	Components& C = grid.components;
+	for (size_t begin = 0, end; begin < groups.size(); begin = end) {
+		end = begin + 1;
+		while (end < groups.size() && groups[end].first == groups[begin].first)
+			end++;
+		if (end - begin < 2)
+			continue;
+		uint32_t keep = std::max_element(groups.begin() + begin, groups.begin() + end, [&C] (std::pair<uint32_t, uint32_t> a, std::pair<uint32_t, uint32_t> b) {
+			return C.sets[a.second].size < C.sets[b.second].size;
+		})->second;
+		for (size_t i = begin; i < end; ++i) {
+			uint32_t set = groups[i].second;
+			if (set == keep)
+				continue;
+			uint32_t root = C.sets[set].root;
+			assert(grid.nodes[root].pred == Node::NO_PRED);
+			grid.nodes[root] = Node{Node::INV, Node::INV};
+			stack.push_back(root);
+			while (!stack.empty()) {
+				uint32_t u = stack.back(); stack.pop_back();
+				for_each_neighbour(grid, u, [&] (uint32_t w) {
+					if (grid.nodes[w].pred == u) {
+						grid.nodes[w] = Node{Node::INV, Node::INV};
+						stack.push_back(w);
+					}
+				});
 			}
-			Point cluster_centre(static_cast<int>(sumx / cluster.size()), static_cast<int>(sumy / cluster.size()));
-			uint32_t cluster_id = grid.pack( *std::min_element(cluster.begin(), cluster.end(), Dist{cluster_centre}) );
-			dijkstra(grid, cluster_id);
-			assert(std::all_of(cluster.begin(), cluster.end(), [&grid] (Point q) { return grid.nodes.at(grid.pack(q)).pred != Node::FLOOD_FILL; }));
+			C.unite(keep, set);
 		}
 	}
+	for (const GridScratch::Region& region : regions) {
+		uint32_t set = C.find(region.set);
+		for (size_t i = region.begin; i < region.end; ++i)
+			C.label[attached[i]] = set;
+		C.sets[set].size += static_cast<uint32_t>(region.end - region.begin);
+	}
+
+	// seed from every tree node bordering the attached regions
+	assert(Q.empty());
+	for (uint32_t id : attached) {
+		for_each_neighbour(grid, id, [&] (uint32_t v) {
+			if (in_tree(v))
+				Q.emplace(grid.nodes[v].cost, v);
+		});
+	}
+	dijkstra_relax(grid, Q);
+	assert(std::all_of(attached.begin(), attached.end(), [&grid] (uint32_t id) { return grid.nodes[id].pred != Node::FLOOD_FILL && grid.nodes[id].pred != Node::INV; }));
+	return true;
 }
 
 } // namespace baseline
@@ -0,0 +1,152 @@
+#ifndef OPT_GPPC_BIDIRECTIONAL_SEARCH_HXX
+#define OPT_GPPC_BIDIRECTIONAL_SEARCH_HXX
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <ostream>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+
+namespace baseline
+{
+
+// side 0 searches from the start, side 1 from the goal
+struct BidirectionalNode
+{
+	uint32_t g[2] = {Node::INV, Node::INV};
+	uint32_t pred[2] = {Node::NO_PRED, Node::NO_PRED};
+	bool closed[2] = {false, false};
+};
+
+/**
+ * Optimal bidirectional A* over the live map.
+ * Both sides share the potential p(v) = (octile(v, goal) - octile(v, start)) / 2, the forward search
+ * adding it and the backward search subtracting it. Either is consistent, so a closed node has its exact
+ * distance from its side's root. Keys are doubled to stay integral: 2g + 2p forward, 2g - 2p backward.
+ * mu is the cheapest start to goal path seen where the two searches touch.
+ * The search stops once the two smallest open keys add up to 2 mu: a cheaper path would leave the forward
+ * closed set at some v and enter the backward one at some w, and the keys of v and w add up to at most
+ * its cost less d(v, w) - p(v) + p(w), which consistency makes non-negative.
+ * The side with fewer open nodes is expanded, so an endpoint walled into a small region runs out of
+ * open nodes within that region and the query fails without searching the rest of the map.
+ */
+struct BidirectionalSearch : Grid
+{
+	BidirectionalSearch(gppc_patch map) : Grid(map)
+	{
+		pool.resize(size());
+	}
+	// searches the live map, only the storage copy follows the changes
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		storage.update(cells, changes, changes_length);
+	}
+
+	std::vector<gppc_point> path;
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		path.clear();
+		expanded = 0;
+		if (!get(s) || !get(g))
+			return false;
+		if (s == g) {
+			// zero path case
+			path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		queries++;
+		root[0] = s; root[1] = g;
+		uint32_t start = pack(s), goal = pack(g);
+		pool.next_search();
+		open[0].clear(); open[1].clear();
+		pool[start].g[0] = 0;
+		open[0].push(open_key(key(0, 0, s), 0), start);
+		pool[goal].g[1] = 0;
+		open[1].push(open_key(key(1, 0, g), 0), goal);
+		uint64_t mu = std::numeric_limits<uint64_t>::max(); // doubled like the keys
+		uint32_t meet = Node::NO_PRED;
+		for (;;) {
+			bool drained = false;
+			for (int side = 0; side < 2; ++side) {
+				// drop stale and closed entries so top() is a live key
+				while (!open[side].empty() && pool[open[side].top().second].closed[side])
+					open[side].pop();
+				drained = drained || open[side].empty();
+			}
+			if (drained) {
+				// a side closed every node it reaches, so the path is either through a node it touched or missing
+				if (meet == Node::NO_PRED)
+					no_path++;
+				break;
+			}
+			if ((open[0].top().first >> 32) + (open[1].top().first >> 32) >= mu)
+				break;
+			int side = open[0].size() <= open[1].size() ? 0 : 1;
+			uint32_t id = open[side].pop().second;
+			BidirectionalNode& node = pool[id];
+			node.closed[side] = true;
+			if (node.closed[1 - side])
+				continue; // its path to the other root is exact and already counted in mu
+			expanded++;
+			uint32_t cost = node.g[side];
+			for_each_successor(*this, id, [this,side,id,cost,&mu,&meet](uint32_t succ, uint32_t edge_cost) {
+				BidirectionalNode& S = pool[succ];
+				if (cost + edge_cost < S.g[side]) {
+					S.g[side] = cost + edge_cost;
+					S.pred[side] = id;
+					open[side].push(open_key(key(side, S.g[side], unpack(succ)), S.g[side]), succ);
+				}
+				if (S.g[1 - side] != Node::INV && 2 * (static_cast<uint64_t>(S.g[0]) + S.g[1]) < mu) {
+					mu = 2 * (static_cast<uint64_t>(S.g[0]) + S.g[1]);
+					meet = succ;
+				}
+			});
+		}
+		if (meet == Node::NO_PRED)
+			return false;
+		for (uint32_t at = meet; at != Node::NO_PRED; at = pool[at].pred[0])
+			push_back(at);
+		std::reverse(path.begin(), path.end());
+		for (uint32_t at = pool[meet].pred[1]; at != Node::NO_PRED; at = pool[at].pred[1])
+			push_back(at);
+		return true;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "bidir_queries " << queries << '\n'
+		    << "bidir_no_path " << no_path << '\n';
+	}
+
+	NodePool<BidirectionalNode> pool;
+	OpenList open[2];
+	size_t expanded = 0; // nodes expanded by the last search, by both sides
+	// counters
+	size_t queries = 0;
+	size_t no_path = 0; // each ended by the side with the smaller region running out of open nodes
+
+protected:
+	// doubled key of a node at distance g from the root of side
+	uint32_t key(int side, uint32_t g, Point p) const noexcept
+	{
+		uint32_t to_goal = octile(p, root[1]), to_start = octile(p, root[0]);
+		// g bounds the octile distance to its own root, so neither key goes negative
+		return side == 0 ? 2 * g + to_goal - to_start : 2 * g + to_start - to_goal;
+	}
+	void push_back(uint32_t cell)
+	{
+		Point p = unpack(cell);
+		path.push_back(gppc_point{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)});
+	}
+
+	Point root[2];
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef OPT_GPPC_BIT_FLOOD_HXX
+#define OPT_GPPC_BIT_FLOOD_HXX
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+#include "Entry.h"
+
+namespace baseline
+{
+
+// occluded fill of the seed bits through the runs of avail they sit in (Kogge-Stone, both directions)
+inline uint64_t fill_word(uint64_t seed, uint64_t avail) noexcept
+{
+	uint64_t up = seed & avail, down = up;
+	uint64_t p = avail;
+	up |= p & (up << 1);  p &= p << 1;
+	up |= p & (up << 2);  p &= p << 2;
+	up |= p & (up << 4);  p &= p << 4;
+	up |= p & (up << 8);  p &= p << 8;
+	up |= p & (up << 16); p &= p << 16;
+	up |= p & (up << 32);
+	p = avail;
+	down |= p & (down >> 1);  p &= p >> 1;
+	down |= p & (down >> 2);  p &= p >> 2;
+	down |= p & (down >> 4);  p &= p >> 4;
+	down |= p & (down >> 8);  p &= p >> 8;
+	down |= p & (down >> 16); p &= p >> 16;
+	down |= p & (down >> 32);
+	return up | down;
+}
+
+/**
+ * Word parallel labeller of 4-connected cells over a row aligned bitmask.
+ * avail holds the cells still to be labelled, fill() claims the component of a cell row by row:
+ * seeds are spread along the row with fill_word and carried across word boundaries, the filled
+ * row seeds the rows above and below, and members are read out with ctz.
+ * avail and the seed rows are left zeroed by fills, so a flood can be reused for sparse sets.
+ */
+struct BitFlood
+{
+	// sizes for a width x height grid, keeps the buffers if the size is unchanged
+	void reset(uint32_t w, uint32_t h)
+	{
+		if (w == width && h == height)
+			return;
+		width = w; height = h;
+		row_words = (w + 63) / 64;
+		avail.assign(static_cast<size_t>(row_words) * h, 0);
+		seeds.assign(avail.size(), 0);
+		seed_lo.assign(h, row_words);
+		seed_hi.assign(h, 0);
+		queued.clear();
+	}
+	// avail becomes every traversable cell of map
+	void load(gppc_patch map)
+	{
+		reset(map.width, map.height);
+		for (uint32_t y = 0; y < height; ++y)
+		for (uint32_t k = 0; k < row_words; ++k)
+			avail[index(y, k)] = read_bits(map.bitarray, static_cast<size_t>(y) * width + k * 64, std::min(64u, width - k * 64));
+		cursor = 0;
+	}
+	void set(uint32_t x, uint32_t y) noexcept
+	{
+		avail[index(y, x / 64)] |= uint64_t{1} << (x % 64);
+	}
+	bool test(uint32_t x, uint32_t y) const noexcept
+	{
+		return (avail[index(y, x / 64)] >> (x % 64)) & 1;
+	}
+	// next unlabelled cell in row-major order at or after the previous one, false once avail is empty
+	bool next(uint32_t& x, uint32_t& y) noexcept
+	{
+		for (; cursor < avail.size(); ++cursor) {
+			if (avail[cursor] != 0) {
+				y = static_cast<uint32_t>(cursor / row_words);
+				x = static_cast<uint32_t>(cursor % row_words) * 64 + static_cast<uint32_t>(__builtin_ctzll(avail[cursor]));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Claims the component of avail containing (x, y) and calls member(x, y) for each of its cells.
+	 */
+	template <typename Fn>
+	void fill(uint32_t x, uint32_t y, Fn&& member)
+	{
+		assert(test(x, y));
+		add_seeds(y, x / 64, uint64_t{1} << (x % 64));
+		while (!queued.empty()) {
+			uint32_t r = queued.back(); queued.pop_back();
+			uint64_t* row = &avail[index(r, 0)];
+			uint64_t* seed = &seeds[index(r, 0)];
+			uint32_t lo = seed_lo[r], hi = seed_hi[r];
+			seed_lo[r] = row_words; seed_hi[r] = 0;
+			// spread within words, then carry runs across word boundaries both ways
+			for (uint32_t k = lo; k <= hi; ++k)
+				seed[k] = fill_word(seed[k], row[k]);
+			for (uint32_t k = lo; k + 1 < row_words && (k < hi || (seed[k] >> 63)); ++k) {
+				if ((seed[k] >> 63) && (row[k + 1] & 1)) {
+					seed[k + 1] |= fill_word(1, row[k + 1]);
+					hi = std::max(hi, k + 1);
+				}
+			}
+			for (uint32_t k = hi; k > 0 && (k > lo || (seed[k] & 1)); --k) {
+				if ((seed[k] & 1) && (row[k - 1] >> 63)) {
+					seed[k - 1] |= fill_word(uint64_t{1} << 63, row[k - 1]);
+					lo = std::min(lo, k - 1);
+				}
+			}
+			// claim the filled cells and seed the neighbouring rows
+			for (uint32_t k = lo; k <= hi; ++k) {
+				uint64_t filled = seed[k];
+				if (filled == 0)
+					continue;
+				seed[k] = 0;
+				row[k] &= ~filled;
+				if (r > 0)
+					add_seeds(r - 1, k, filled);
+				if (r + 1 < height)
+					add_seeds(r + 1, k, filled);
+				for (uint64_t m = filled; m != 0; m &= m - 1)
+					member(k * 64 + static_cast<uint32_t>(__builtin_ctzll(m)), r);
+			}
+		}
+	}
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t row_words = 0;
+	std::vector<uint64_t> avail; // row aligned, lsb first
+	std::vector<uint64_t> seeds; // pending seeds of queued rows
+	std::vector<uint32_t> seed_lo, seed_hi; // word range of pending seeds per row
+	std::vector<uint32_t> queued; // rows with pending seeds
+	size_t cursor = 0; // next() resumes here
+
+private:
+	size_t index(uint32_t y, uint32_t k) const noexcept
+	{
+		return static_cast<size_t>(y) * row_words + k;
+	}
+	void add_seeds(uint32_t r, uint32_t k, uint64_t bits)
+	{
+		bits &= avail[index(r, k)] & ~seeds[index(r, k)];
+		if (bits == 0)
+			return;
+		if (seed_lo[r] > seed_hi[r])
+			queued.push_back(r);
+		seeds[index(r, k)] |= bits;
+		seed_lo[r] = std::min(seed_lo[r], k);
+		seed_hi[r] = std::max(seed_hi[r], k);
+	}
+	// count (<= 64) bits of the lsb first bitarray from bit offset
+	static uint64_t read_bits(const uint8_t* bits, size_t offset, uint32_t count) noexcept
+	{
+		const uint8_t* p = bits + offset / 8;
+		uint32_t shift = static_cast<uint32_t>(offset % 8);
+		uint64_t v = 0;
+		for (uint32_t b = 0; b < 8 && b * 8 < count + shift; ++b)
+			v |= static_cast<uint64_t>(p[b]) << (8 * b);
+		v >>= shift;
+		if (shift != 0 && count + shift > 64)
+			v |= static_cast<uint64_t>(p[8]) << (64 - shift);
+		return count == 64 ? v : v & ((uint64_t{1} << count) - 1);
+	}
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef OPT_GPPC_COMPACT_TREE_SEARCH_HXX
+#define OPT_GPPC_COMPACT_TREE_SEARCH_HXX
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+
+namespace baseline
+{
+
+/**
+ * Shortest path trees of the clusters without their costs.
+ * Each cell keeps the direction to its pred as a 3-bit code, 21 codes to a word, and its depth in
+ * the tree as 16 bits. Depths from DEEP up are saturated and recounted by walking to the root.
+ * Roots have depth 0, the codes of roots and blocked cells are unused.
+ */
+struct CompactTree
+{
+	static constexpr uint32_t CODES_PER_WORD = 21;
+	static constexpr uint16_t DEEP = 0xFFFF;
+
+	// a flood filled cluster with the bounding box of its cells
+	struct Cluster
+	{
+		size_t size;
+		uint32_t root;
+		uint32_t x0, y0, x1, y1;
+	};
+
+	// sizes the trees for grid, every cell unset
+	void reset(const Grid& grid)
+	{
+		// codes follow the successor order N, E, S, W, NE, NW, SE, SW
+		for (int i = 0; i < 8; ++i)
+			offsets[i] = SUCCESSOR_DY[i] * static_cast<int32_t>(grid.width) + SUCCESSOR_DX[i];
+		uint32_t size = static_cast<uint32_t>(grid.size());
+		dirs.assign((size + CODES_PER_WORD - 1) / CODES_PER_WORD, 0);
+		depths.assign(size, 0);
+	}
+	// clears the code of cell before its cluster is grown again
+	void unset(uint32_t id) noexcept
+	{
+		dirs[id / CODES_PER_WORD] &= ~(uint64_t{7} << (3 * (id % CODES_PER_WORD)));
+	}
+
+	/**
+	 * Grows the tree of cluster c by a dijkstra from its root, with the costs kept in cost over the
+	 * cluster's bounding box only. A settled cell takes as pred its first neighbour in successor order
+	 * whose cost plus the step is its own, which is settled before it.
+	 * Clusters may be grown concurrently, the codes of neighbouring clusters share words.
+	 */
+	template <typename Queue>
+	void grow(const Grid& grid, Queue& Q, std::vector<uint32_t>& cost, const Cluster& c)
+	{
+		uint32_t box_width = c.x1 - c.x0 + 1;
+		cost.assign(static_cast<size_t>(box_width) * (c.y1 - c.y0 + 1), uint32_t{Node::INV});
+		auto&& local = [&c,box_width] (uint32_t x, uint32_t y) {
+			return static_cast<size_t>(y - c.y0) * box_width + (x - c.x0);
+		};
+		Point r = grid.unpack(c.root);
+		cost[local(static_cast<uint32_t>(r.first), static_cast<uint32_t>(r.second))] = 0;
+		depths[c.root] = 0;
+		assert(Q.empty());
+		Q.emplace(0, c.root);
+		while (!Q.empty()) {
+			auto top = Q.top(); Q.pop();
+			uint32_t at_cost = top.first, id = top.second;
+			Point p = grid.unpack(id);
+			uint32_t x = static_cast<uint32_t>(p.first), y = static_cast<uint32_t>(p.second);
+			if (at_cost != cost[local(x, y)])
+				continue; // stale
+			uint32_t moves = SUCCESSOR_TABLE[grid.storage.block3(x, y)];
+			if (id != c.root) {
+				uint64_t code = 0;
+				for (uint32_t m = moves; m != 0; m &= m - 1) {
+					uint32_t d = static_cast<uint32_t>(__builtin_ctz(m));
+					if (cost[local(x + SUCCESSOR_DX[d], y + SUCCESSOR_DY[d])] + SUCCESSOR_COST[d] == at_cost) {
+						code = d;
+						break;
+					}
+				}
+				__atomic_fetch_or(&dirs[id / CODES_PER_WORD], code << (3 * (id % CODES_PER_WORD)), __ATOMIC_RELAXED);
+				uint16_t d = depths[pred(id)];
+				depths[id] = d < DEEP ? static_cast<uint16_t>(d + 1) : DEEP;
+			}
+			for (; moves != 0; moves &= moves - 1) {
+				uint32_t d = static_cast<uint32_t>(__builtin_ctz(moves));
+				uint32_t& succ = cost[local(x + SUCCESSOR_DX[d], y + SUCCESSOR_DY[d])];
+				if (at_cost + SUCCESSOR_COST[d] < succ) {
+					succ = at_cost + SUCCESSOR_COST[d];
+					Q.emplace(succ, static_cast<uint32_t>(static_cast<int32_t>(id) + offsets[d]));
+				}
+			}
+		}
+	}
+
+	uint32_t pred(uint32_t id) const noexcept
+	{
+		uint32_t code = static_cast<uint32_t>(dirs[id / CODES_PER_WORD] >> (3 * (id % CODES_PER_WORD))) & 7;
+		return static_cast<uint32_t>(static_cast<int32_t>(id) + offsets[code]);
+	}
+	uint32_t depth(uint32_t id) const noexcept
+	{
+		if (depths[id] != DEEP)
+			return depths[id];
+		// saturated, count up to the first cell with an exact depth
+		uint32_t d = 0;
+		for (; depths[id] == DEEP; id = pred(id))
+			d++;
+		return d + depths[id];
+	}
+	size_t bytes() const noexcept
+	{
+		return dirs.size() * sizeof(uint64_t) + depths.size() * sizeof(uint16_t);
+	}
+
+	std::vector<uint64_t> dirs;
+	std::vector<uint16_t> depths;
+	std::array<int32_t, 8> offsets;
+};
+
+/**
+ * SpanningTreeSearch storing its trees as a CompactTree: 8/21 bytes of codes, 2 of depth and 4 of
+ * component label, about 6.4 bytes per cell against 12 for Node and labels.
+ * Without costs the trees cannot be repaired cell by cell, a map change instead grows again the clusters
+ * that hold a flipped cell or a neighbour of one, and leaves the others as they are. Each cluster is
+ * grown with its costs over its bounding box, at most one box per pool worker at a time, then dropped.
+ */
+struct CompactTreeSearch : Grid
+{
+	CompactTreeSearch(gppc_patch map, unsigned threads = setup_threads())
+		: Grid(map), pool(threads), queues(pool.size()), costs(pool.size()), shadow(map)
+	{
+		update_grid();
+	}
+	// grows the trees of every cluster
+	void update_grid()
+	{
+		components.clear(size());
+		tree.reset(*this);
+		flood.load(cells);
+		clusters.clear();
+		for (uint32_t x, y; flood.next(x, y); )
+			claim_cluster(x, y);
+		grow_clusters();
+		rebuilds++;
+	}
+	// grows again the clusters holding a flipped cell or a neighbour of one, unless the patches left
+	// every cell as it was
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		if (!shadow.diff(cells, changes, changes_length))
+			return;
+		storage.update(cells, changes, changes_length);
+		for (uint32_t id : shadow.closed)
+			components.remove(id);
+		flood.load(cells);
+		clusters.clear();
+		auto&& seed = [this] (uint32_t id) {
+			Point p = unpack(id);
+			uint32_t x = static_cast<uint32_t>(p.first), y = static_cast<uint32_t>(p.second);
+			if (flood.test(x, y))
+				claim_cluster(x, y);
+		};
+		for (uint32_t id : shadow.opened)
+			seed(id);
+		for (uint32_t id : shadow.closed)
+			for_each_neighbour(*this, id, seed);
+		grow_clusters();
+		if (components.sets.size() > 2 * static_cast<size_t>(components.live) + 1024)
+			components.compact(); // regrown clusters left their old sets dead
+		repairs++;
+	}
+	ThreadPool pool;
+	std::vector<DijkstraQueue> queues;
+	std::vector<std::vector<uint32_t>> costs; // scratch of each pool worker, only while growing
+	std::vector<CompactTree::Cluster> clusters; // to grow, largest first
+	ShadowMap shadow; // map as of the last change
+	CompactTree tree;
+	std::array<std::vector<gppc_point>, 2> path_parts;
+	bool turning_points = false; // only return the cells where the path turns
+	size_t rebuilds = 0;
+	size_t repairs = 0;
+	size_t regrown = 0; // cells of the clusters grown by repairs
+	const std::vector<gppc_point>& get_path() const noexcept { return path_parts[0]; }
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		auto&& push_back = [this](std::vector<gppc_point>& path, Point p) {
+			push_path_point(path, p, turning_points);
+		};
+		uint32_t a = pack(s), b = pack(g);
+		if (!components.connected(a, b))
+			return false;
+		if (a == b) {
+			// zero path case
+			path_parts[0].assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		path_parts[0].clear(); path_parts[1].clear();
+		// lift the deeper end to the other's depth, then both until they meet
+		uint32_t da = tree.depth(a), db = tree.depth(b);
+		for (; da > db; --da, a = tree.pred(a))
+			push_back(path_parts[0], unpack(a));
+		for (; db > da; --db, b = tree.pred(b))
+			push_back(path_parts[1], unpack(b));
+		for (; a != b; a = tree.pred(a), b = tree.pred(b)) {
+			push_back(path_parts[0], unpack(a));
+			push_back(path_parts[1], unpack(b));
+		}
+		push_back(path_parts[0], unpack(a));
+		append_reversed(path_parts[0], path_parts[1], turning_points);
+		return true;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "compact_tree_bytes " << tree.bytes() << '\n'
+		    << "compact_tree_rebuilds " << rebuilds << '\n'
+		    << "compact_tree_repairs " << repairs << '\n'
+		    << "compact_tree_regrown_cells " << regrown << '\n';
+		shadow.print_stats(out);
+	}
+
+protected:
+	// floods the cluster of (x, y), moves its cells out of their old component into a new one and clears their codes
+	void claim_cluster(uint32_t x, uint32_t y)
+	{
+		std::vector<Point>& cluster = scratch.cluster;
+		cluster.clear();
+		CompactTree::Cluster c{0, 0, x, y, x, y};
+		flood.fill(x, y, [this,&cluster,&c] (uint32_t mx, uint32_t my) {
+			cluster.emplace_back(static_cast<int>(mx), static_cast<int>(my));
+			c.x0 = std::min(c.x0, mx); c.x1 = std::max(c.x1, mx);
+			c.y0 = std::min(c.y0, my); c.y1 = std::max(c.y1, my);
+		});
+		for (Point p : cluster) {
+			uint32_t id = pack(p);
+			if (components.label[id] != Node::INV)
+				components.remove(id);
+			tree.unset(id);
+		}
+		c.size = cluster.size();
+		c.root = cluster_root(*this, cluster);
+		label_cluster(*this, cluster, c.root);
+		clusters.push_back(c);
+	}
+	// grows the claimed clusters on the pool, largest first
+	void grow_clusters()
+	{
+		std::sort(clusters.begin(), clusters.end(), [] (const CompactTree::Cluster& a, const CompactTree::Cluster& b) {
+			return a.size > b.size || (a.size == b.size && a.root < b.root);
+		});
+		pool.run(clusters.size(), [this] (size_t task, unsigned worker) {
+			tree.grow(*this, queues[worker], costs[worker], clusters[task]);
+		});
+		for (std::vector<uint32_t>& cost : costs)
+			std::vector<uint32_t>().swap(cost);
+		for (const CompactTree::Cluster& c : clusters)
+			regrown += c.size;
+	}
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef OPT_GPPC_ENGINE_HOOKS_HXX
+#define OPT_GPPC_ENGINE_HOOKS_HXX
+
+#include <ostream>
+
+namespace baseline
+{
+
+// Optional engine members, called with 0 so the int overload wins when the member exists.
+
+// engines with counters print them, the others print nothing
+template <typename Engine>
+auto print_stats(const Engine& engine, std::ostream& out, int) -> decltype(engine.print_stats(out), void())
+{
+	engine.print_stats(out);
+}
+template <typename Engine>
+void print_stats(const Engine&, std::ostream&, long)
+{ }
+
+// engines that stream a path in parts report the returned part as a prefix through incomplete()
+template <typename Engine>
+auto is_incomplete(const Engine& engine, int) -> decltype(engine.incomplete())
+{
+	return engine.incomplete();
+}
+template <typename Engine>
+bool is_incomplete(const Engine&, long)
+{
+	return false;
+}
+
+} // namespace baseline
+
+#endif
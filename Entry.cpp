@@ -1,51 +1,172 @@
 #include "Entry.h"
+#include <cstdlib>
+#include <utility>
+#include <chrono>
+#include <iostream>
+#include "EngineHooks.hxx"
+
+// engine is picked at configure time, see GPPC_ENGINE in CMakeLists.txt
+#if defined(GPPC_ENGINE_COMPACT_TREE)
+#include "CompactTreeSearch.hxx"
+using SelectedEngine = baseline::CompactTreeSearch;
+#define GPPC_ENGINE_NAME "example-DynamicCompactTreeSearch-8N"
+#elif defined(GPPC_ENGINE_ASTAR)
+#include "AStarSearch.hxx"
+using SelectedEngine = baseline::AStarSearch;
+#define GPPC_ENGINE_NAME "example-DynamicAStar-8N"
+#elif defined(GPPC_ENGINE_JPS)
+#include "JumpPointSearch.hxx"
+using SelectedEngine = baseline::JumpPointSearch;
+#define GPPC_ENGINE_NAME "example-DynamicJPS-8N"
+#elif defined(GPPC_ENGINE_LPASTAR)
+#include "LPAStarSearch.hxx"
+using SelectedEngine = baseline::LPAStarSearch;
+#define GPPC_ENGINE_NAME "example-DynamicLPAStar-8N"
+#elif defined(GPPC_ENGINE_SLICED_ASTAR)
+#include "SlicedAStarSearch.hxx"
+using SelectedEngine = baseline::SlicedAStarSearch;
+#define GPPC_ENGINE_NAME "example-DynamicSlicedAStar-8N"
+#elif defined(GPPC_ENGINE_BACKGROUND_TREE)
+#include "BackgroundTreeSearch.hxx"
+using SelectedEngine = baseline::BackgroundTreeSearch;
+#define GPPC_ENGINE_NAME "example-DynamicBackgroundTreeSearch-8N"
+#elif defined(GPPC_ENGINE_HPASTAR)
+#include "SectorSearch.hxx"
+using SelectedEngine = baseline::SectorSearch;
+#define GPPC_ENGINE_NAME "example-DynamicHPAStar-8N"
+#elif defined(GPPC_ENGINE_BIDIRECTIONAL)
+#include "BidirectionalSearch.hxx"
+using SelectedEngine = baseline::BidirectionalSearch;
+#define GPPC_ENGINE_NAME "example-DynamicBidirectionalAStar-8N"
+#elif defined(GPPC_ENGINE_SUBGOAL)
+#include "SubgoalGraphSearch.hxx"
+using SelectedEngine = baseline::SubgoalGraphSearch;
+#define GPPC_ENGINE_NAME "example-DynamicSubgoalGraph-8N"
+#else
 #include "BaselineSearch.hxx"
+using SelectedEngine = baseline::SpanningTreeSearch;
+#define GPPC_ENGINE_NAME "example-DynamicSpanningTreeSearch-8N"
+#endif
+// repeated queries are answered from a cache of GPPC_PATH_CACHE paths, see CMakeLists.txt
+#if GPPC_PATH_CACHE > 0
+#include "PathCache.hxx"
+using SearchEngine = baseline::CachedSearch<SelectedEngine>;
+#else
+using SearchEngine = SelectedEngine;
+#endif
+
+// tree engines can return turning points only, see GPPC_TURNING_POINTS in CMakeLists.txt
+template <typename Engine>
+auto set_turning_points(Engine& engine, bool on, int) -> decltype(engine.turning_points = on, void())
+{
+  engine.turning_points = on;
+}
+template <typename Engine>
+void set_turning_points(Engine&, bool, long)
+{ }
+// engines that can return a path's start before the rest, see GPPC_STREAM_PREFIX in CMakeLists.txt
+template <typename Engine>
+auto set_stream_prefix(Engine& engine, bool on, int) -> decltype(engine.stream_prefix = on, void())
+{
+  engine.stream_prefix = on;
+}
+template <typename Engine>
+void set_stream_prefix(Engine&, bool, long)
+{ }
+// engines that suspend a search once a call has spent its budget, see GPPC_SLICE_* in CMakeLists.txt
+template <typename Engine>
+auto set_slice_budget(Engine& engine, size_t expansions, long micros, int) -> decltype(engine.expansion_budget = expansions, void())
+{
+  engine.expansion_budget = expansions;
+  engine.time_budget = std::chrono::microseconds(micros);
+}
+template <typename Engine>
+void set_slice_budget(Engine&, size_t, long, long)
+{ }
+
+// engines with an index write it in preprocessing and load it in gppc_search_init
+template <typename Engine>
+auto preprocess(gppc_patch map, const char* filename, int) -> decltype(std::declval<const Engine&>().save_index(filename), void())
+{
+  if (!Engine(map).save_index(filename))
+    std::cerr << "Failed to write index " << filename << '\n';
+}
+template <typename Engine>
+void preprocess(gppc_patch, const char*, long)
+{ }
+template <typename Engine>
+auto load_engine(gppc_patch map, const char* filename, int) -> decltype(new Engine(map, filename))
+{
+  return new Engine(map, filename);
+}
+template <typename Engine>
+Engine* load_engine(gppc_patch map, const char*, long)
+{
+  return new Engine(map);
+}
 
 
 void gppc_preprocess_init_map(gppc_patch init_map, const char* preprocess_filename)
-{}
+{
+  // SpanningTreeSearch stores its trees and component labels, see write_tree_index
+  preprocess<SearchEngine>(init_map, preprocess_filename, 0);
+}
 
 
 void *gppc_search_init(gppc_patch active_map, const char* preprocess_filename)
 {
-  auto* STS = new baseline::SpanningTreeSearch(active_map);
-  return STS;
+  // maps the index when present and valid, otherwise builds from the map
+  auto* engine = load_engine<SearchEngine>(active_map, preprocess_filename, 0);
+#ifdef GPPC_TURNING_POINTS
+  set_turning_points(*engine, true, 0);
+#endif
+#ifdef GPPC_STREAM_PREFIX
+  set_stream_prefix(*engine, true, 0);
+#endif
+  set_slice_budget(*engine, GPPC_SLICE_EXPANSIONS, GPPC_SLICE_MICROSECONDS, 0);
+#if GPPC_PATH_CACHE > 0
+  engine->cache.capacity = GPPC_PATH_CACHE;
+#endif
+  return engine;
 }
 
 
 void gppc_map_change(void *data, const gppc_patch* changes, uint32_t changes_length)
 {
-  auto* STS = static_cast<baseline::SpanningTreeSearch*>(data);
-  // SpanningTreeSearch must update its internal structure.
-  // It is not smart, so it will update the whole map, thus ignores changes.
-  STS->update_grid();
+  auto* engine = static_cast<SearchEngine*>(data);
+  // The engine must update its internal structure.
+  // SpanningTreeSearch repairs the trees around the changed cells, falling back to a full rebuild for large changes.
+  engine->update_grid(changes, changes_length);
 }
 
 
 gppc_path gppc_get_path(void *data, gppc_point start, gppc_point goal)
 {
-  auto* STS = static_cast<baseline::SpanningTreeSearch*>(data);
-  bool exists = STS->search(baseline::Point(start.x, start.y), baseline::Point(goal.x, goal.y));
+  auto* engine = static_cast<SearchEngine*>(data);
+  bool exists = engine->search(baseline::Point(start.x, start.y), baseline::Point(goal.x, goal.y));
   if (!exists)
     return gppc_path{};
   
-  auto& path = STS->get_path();
+  auto& path = engine->get_path();
   gppc_path res_path{};
   res_path.path = path.data();
   res_path.length = path.size();
-  // res_path.incomplete = 0; // not required as value-init defaults it to 0
+  res_path.incomplete = baseline::is_incomplete(*engine, 0);
   return res_path;
 }
 
 
 void gppc_free_data(void *data)
 {
-  auto* STS = static_cast<baseline::SpanningTreeSearch*>(data);
-  delete STS;
+  auto* engine = static_cast<SearchEngine*>(data);
+  // engines with counters print them when GPPC_ENGINE_STATS is set
+  if (std::getenv("GPPC_ENGINE_STATS") != nullptr)
+    baseline::print_stats(*engine, std::cerr, 0);
+  delete engine;
 }
 
 
 const char* gppc_get_name()
 {
-  return "example-DynamicSpanningTreeSearch-8N";
+  return GPPC_ENGINE_NAME;
 }
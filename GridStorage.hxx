@@ -0,0 +1,295 @@
+#ifndef OPT_GPPC_GRID_STORAGE_HXX
+#define OPT_GPPC_GRID_STORAGE_HXX
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+#include "Entry.h"
+
+namespace baseline
+{
+
+/**
+ * Storage policies for the traversability of a grid, the Cells of BasicGrid.
+ * Each keeps its layout in step with the live map through load(map) and update(map, changes),
+ * answers get(x, y) for -1 <= x <= width, -1 <= y <= height with cells outside the map blocked,
+ * and block3(x, y) for in-bounds cells: the 3x3 block around (x, y) with bit 3 * (dy + 1) + (dx + 1)
+ * set if cell (x + dx, y + dy) is traversable.
+ */
+
+/**
+ * Reads the harness bitarray in place, every access is bounds checked.
+ */
+struct BitarrayCells
+{
+	BitarrayCells() = default;
+	explicit BitarrayCells(gppc_patch map)
+	{
+		load(map);
+	}
+	void load(gppc_patch map)
+	{
+		cells = map;
+	}
+	// the harness map already holds the changes
+	void update(gppc_patch, const gppc_patch*, uint32_t)
+	{ }
+
+	bool get(int x, int y) const noexcept
+	{
+		return static_cast<uint32_t>(x) < cells.width && static_cast<uint32_t>(y) < cells.height
+		    && gppc_patch_get_xy(cells, static_cast<uint16_t>(x), static_cast<uint16_t>(y));
+	}
+	uint32_t block3(uint32_t x, uint32_t y) const noexcept
+	{
+		uint32_t m = 0;
+		for (int i = 0, dy = -1; dy < 2; dy++)
+		for (int dx = -1; dx < 2; dx++)
+			m |= static_cast<uint32_t>(get(static_cast<int>(x) + dx, static_cast<int>(y) + dy)) << i++;
+		return m;
+	}
+
+	gppc_patch cells{};
+};
+
+// copies count cells from bit src_bit of an lsb first bitarray to bit dst_bit of another
+inline void copy_bits(const uint8_t* src, size_t src_bit, uint8_t* dst, size_t dst_bit, uint32_t count) noexcept
+{
+	while (count != 0) {
+		uint32_t n = std::min(count, 56u);
+		uint64_t v = 0;
+		const uint8_t* s = src + src_bit / 8;
+		uint32_t src_shift = static_cast<uint32_t>(src_bit % 8);
+		for (uint32_t b = 0; b * 8 < n + src_shift; ++b)
+			v |= static_cast<uint64_t>(s[b]) << (8 * b);
+		v = (v >> src_shift) & ((uint64_t{1} << n) - 1);
+		uint32_t dst_shift = static_cast<uint32_t>(dst_bit % 8);
+		uint64_t mask = ((uint64_t{1} << n) - 1) << dst_shift;
+		uint8_t* d = dst + dst_bit / 8;
+		for (uint32_t b = 0; b * 8 < n + dst_shift; ++b)
+			d[b] = static_cast<uint8_t>((d[b] & ~(mask >> (8 * b))) | ((v << dst_shift) >> (8 * b)));
+		src_bit += n; dst_bit += n; count -= n;
+	}
+}
+
+/**
+ * Copy of the traversability bitmap framed by a one cell border of blocked cells.
+ * Cell (x, y) sits at bit x + 1 of padded row y + 1, so every neighbour of an in-bounds cell is
+ * addressable and reads need no bounds checks. Rows are whole bytes, lsb first like gppc_patch,
+ * and the buffer carries a word of slack so unaligned loads past the last row stay in it.
+ */
+struct PaddedMap
+{
+	static constexpr uint32_t BORDER = 1;
+
+	PaddedMap() = default;
+	explicit PaddedMap(gppc_patch map)
+	{
+		load(map);
+	}
+	// copies every cell of map
+	void load(gppc_patch map)
+	{
+		width = map.width; height = map.height;
+		stride = (width + 2 * BORDER + 7) / 8;
+		bits.assign(static_cast<size_t>(stride) * (height + 2 * BORDER) + sizeof(uint64_t), 0);
+		for (uint32_t y = 0; y < height; ++y)
+			copy_run(map.bitarray, static_cast<size_t>(y) * width, 0, y, width);
+	}
+	// copies the cells of map under each patch rectangle, map must already hold the changes
+	void update(gppc_patch map, const gppc_patch* changes, uint32_t changes_length)
+	{
+		for (uint32_t i = 0; i < changes_length; ++i) {
+			const gppc_patch& patch = changes[i];
+			for (uint32_t y = patch.pos.y, ye = y + patch.height; y < ye; ++y)
+				copy_run(map.bitarray, static_cast<size_t>(y) * width + patch.pos.x, patch.pos.x, y, patch.width);
+		}
+	}
+
+	bool get(int x, int y) const noexcept
+	{
+		assert(-1 <= x && x <= static_cast<int>(width) && -1 <= y && y <= static_cast<int>(height));
+		size_t bit = static_cast<size_t>(x + 1);
+		return (row(static_cast<uint32_t>(y + 1))[bit / 8] >> (bit % 8)) & 1;
+	}
+	uint32_t block3(uint32_t x, uint32_t y) const noexcept
+	{
+		assert(x < width && y < height);
+		// bits x .. x + 2 of the padded rows y .. y + 2 hold columns x - 1 .. x + 1
+		const uint8_t* r = row(y) + x / 8;
+		uint32_t shift = x % 8;
+		uint32_t m = 0;
+		for (uint32_t i = 0; i < 3; ++i, r += stride) {
+			uint16_t w;
+			std::memcpy(&w, r, sizeof(w));
+			m |= ((static_cast<uint32_t>(w) >> shift) & 7u) << (3 * i);
+		}
+		return m;
+	}
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t stride = 0; // bytes per padded row
+	std::vector<uint8_t> bits;
+
+private:
+	const uint8_t* row(uint32_t padded_y) const noexcept
+	{
+		return bits.data() + static_cast<size_t>(padded_y) * stride;
+	}
+	// copies count cells from bit src_bit of an lsb first bitarray to cells (x, y) onwards of row y
+	void copy_run(const uint8_t* src, size_t src_bit, uint32_t x, uint32_t y, uint32_t count)
+	{
+		copy_bits(src, src_bit, bits.data(), static_cast<size_t>(y + BORDER) * stride * 8 + x + BORDER, count);
+	}
+};
+
+/**
+ * One byte per cell with a one cell blocked border, cell (x, y) at (y + 1) * stride + x + 1.
+ * Eight times the memory of PaddedMap, but a cell is a plain load without shifts.
+ */
+struct ByteCells
+{
+	static constexpr uint32_t BORDER = 1;
+
+	ByteCells() = default;
+	explicit ByteCells(gppc_patch map)
+	{
+		load(map);
+	}
+	void load(gppc_patch map)
+	{
+		width = map.width; height = map.height;
+		stride = width + 2 * BORDER;
+		bytes.assign(static_cast<size_t>(stride) * (height + 2 * BORDER), 0);
+		for (uint32_t y = 0; y < height; ++y)
+			copy_run(map, 0, y, width);
+	}
+	void update(gppc_patch map, const gppc_patch* changes, uint32_t changes_length)
+	{
+		for (uint32_t i = 0; i < changes_length; ++i) {
+			const gppc_patch& patch = changes[i];
+			for (uint32_t y = patch.pos.y, ye = y + patch.height; y < ye; ++y)
+				copy_run(map, patch.pos.x, y, patch.width);
+		}
+	}
+
+	bool get(int x, int y) const noexcept
+	{
+		assert(-1 <= x && x <= static_cast<int>(width) && -1 <= y && y <= static_cast<int>(height));
+		return bytes[static_cast<size_t>(y + 1) * stride + static_cast<uint32_t>(x + 1)] != 0;
+	}
+	uint32_t block3(uint32_t x, uint32_t y) const noexcept
+	{
+		assert(x < width && y < height);
+		const uint8_t* r = bytes.data() + static_cast<size_t>(y) * stride + x;
+		uint32_t m = 0;
+		for (uint32_t i = 0; i < 3; ++i, r += stride)
+			m |= (static_cast<uint32_t>(r[0]) | static_cast<uint32_t>(r[1]) << 1 | static_cast<uint32_t>(r[2]) << 2) << (3 * i);
+		return m;
+	}
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t stride = 0; // bytes per padded row
+	std::vector<uint8_t> bytes; // 0 or 1
+
+private:
+	void copy_run(gppc_patch map, uint32_t x, uint32_t y, uint32_t count)
+	{
+		uint8_t* d = bytes.data() + static_cast<size_t>(y + BORDER) * stride + x + BORDER;
+		size_t id = static_cast<size_t>(y) * width + x;
+		for (uint32_t i = 0; i < count; ++i, ++id)
+			d[i] = static_cast<uint8_t>((map.bitarray[id >> 3] >> (id & 7)) & 1);
+	}
+};
+
+/**
+ * TILE x TILE blocks of cells packed into one word each, with a one cell blocked border.
+ * Padded cell (x + 1, y + 1) is bit (py % TILE) * TILE + px % TILE of tile (py / TILE, px / TILE), so a
+ * cell's vertical neighbours usually share its word rather than sitting a row stride away.
+ */
+struct TiledCells
+{
+	static constexpr uint32_t BORDER = 1;
+	static constexpr uint32_t TILE = 8;
+
+	TiledCells() = default;
+	explicit TiledCells(gppc_patch map)
+	{
+		load(map);
+	}
+	void load(gppc_patch map)
+	{
+		width = map.width; height = map.height;
+		tiles_wide = (width + 2 * BORDER + TILE - 1) / TILE;
+		tiles.assign(static_cast<size_t>(tiles_wide) * ((height + 2 * BORDER + TILE - 1) / TILE), 0);
+		for (uint32_t y = 0; y < height; ++y)
+			copy_run(map, 0, y, width);
+	}
+	void update(gppc_patch map, const gppc_patch* changes, uint32_t changes_length)
+	{
+		for (uint32_t i = 0; i < changes_length; ++i) {
+			const gppc_patch& patch = changes[i];
+			for (uint32_t y = patch.pos.y, ye = y + patch.height; y < ye; ++y)
+				copy_run(map, patch.pos.x, y, patch.width);
+		}
+	}
+
+	bool get(int x, int y) const noexcept
+	{
+		assert(-1 <= x && x <= static_cast<int>(width) && -1 <= y && y <= static_cast<int>(height));
+		uint32_t px = static_cast<uint32_t>(x + 1), py = static_cast<uint32_t>(y + 1);
+		return (tile(px, py) >> bit(px, py)) & 1;
+	}
+	uint32_t block3(uint32_t x, uint32_t y) const noexcept
+	{
+		assert(x < width && y < height);
+		// padded columns x .. x + 2 of padded rows y .. y + 2
+		uint32_t m = 0;
+		for (uint32_t i = 0; i < 3; ++i)
+			m |= row3(x, y + i) << (3 * i);
+		return m;
+	}
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tiles_wide = 0;
+	std::vector<uint64_t> tiles;
+
+private:
+	uint64_t tile(uint32_t px, uint32_t py) const noexcept
+	{
+		return tiles[static_cast<size_t>(py / TILE) * tiles_wide + px / TILE];
+	}
+	static uint32_t bit(uint32_t px, uint32_t py) noexcept
+	{
+		return (py % TILE) * TILE + px % TILE;
+	}
+	// padded cells px .. px + 2 of padded row py as 3 bits
+	uint32_t row3(uint32_t px, uint32_t py) const noexcept
+	{
+		uint32_t in = px % TILE;
+		uint32_t r = static_cast<uint32_t>(tile(px, py) >> ((py % TILE) * TILE)) & 0xFFu;
+		if (in + 3 > TILE)
+			r |= (static_cast<uint32_t>(tile(px + TILE, py) >> ((py % TILE) * TILE)) & 0xFFu) << TILE;
+		return (r >> in) & 7u;
+	}
+	void copy_run(gppc_patch map, uint32_t x, uint32_t y, uint32_t count)
+	{
+		size_t id = static_cast<size_t>(y) * width + x;
+		uint32_t py = y + BORDER;
+		for (uint32_t i = 0; i < count; ++i, ++id) {
+			uint32_t px = x + i + BORDER;
+			uint64_t& t = tiles[static_cast<size_t>(py / TILE) * tiles_wide + px / TILE];
+			uint64_t b = uint64_t{1} << bit(px, py);
+			t = (map.bitarray[id >> 3] >> (id & 7)) & 1 ? t | b : t & ~b;
+		}
+	}
+};
+
+} // namespace baseline
+
+#endif
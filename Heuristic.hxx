@@ -0,0 +1,252 @@
+#ifndef OPT_GPPC_HEURISTIC_HXX
+#define OPT_GPPC_HEURISTIC_HXX
+
+#include <vector>
+#include <array>
+#include <ostream>
+#include <algorithm>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+
+namespace baseline
+{
+
+/**
+ * Goal distance estimates of BasicAStarSearch. A heuristic is built from the map, follows its changes
+ * in update(), is told the goal by set_goal() and returns the estimate of a cell from operator().
+ */
+
+// octile distance, the default
+struct OctileHeuristic
+{
+	explicit OctileHeuristic(gppc_patch)
+	{ }
+	void update(gppc_patch, const gppc_patch*, uint32_t) noexcept
+	{ }
+	void set_goal(Point g) noexcept { goal = g; }
+	uint32_t operator()(Point p) const noexcept { return octile(p, goal); }
+
+	Point goal;
+};
+
+// bumped whenever the section order or layout of the landmark index change
+constexpr uint32_t LANDMARK_INDEX_VERSION = 1;
+
+/**
+ * Differential heuristic over K landmarks, the larger of the octile distance and every |d(L, p) - d(L, g)|.
+ * The landmarks are picked farthest first in the largest region of the starting map, each one
+ * maximising its distance to those before it.
+ * Distances are kept over every cell that was ever open, a superset of the live map in which no
+ * distance is longer than on the live map, so the estimate stays admissible and consistent however
+ * the map changes. Closed cells only lengthen live distances and are ignored. A cell opened for the
+ * first time can shorten them: it is added and a dijkstra lowers the distances it improves, which
+ * only visits the cells that get closer.
+ * Cells no landmark reached, e.g. outside the largest region, fall back to octile.
+ */
+template <uint32_t K>
+struct DifferentialHeuristic
+{
+	explicit DifferentialHeuristic(gppc_patch map) : width(map.width), height(map.height), key(map_key(map))
+		,reach(map), shadow(map)
+	{
+		build();
+	}
+	// reads the distances from an index written by save_index, builds them if it is missing or stale
+	DifferentialHeuristic(gppc_patch map, const char* index_file) : width(map.width), height(map.height), key(map_key(map))
+		,reach(map), shadow(map)
+	{
+		if (!load_index(index_file))
+			build();
+	}
+	bool save_index(const char* filename) const
+	{
+		return write_index(filename, LANDMARK_INDEX_VERSION, key, {
+			IndexSection{landmarks.data(), K * sizeof(uint32_t)},
+			IndexSection{dist.data(), dist.size() * sizeof(uint32_t)}
+		});
+	}
+
+	// adds the cells opened for the first time and lowers the distances through them
+	void update(gppc_patch map, const gppc_patch* changes, uint32_t changes_length)
+	{
+		if (!shadow.diff(map, changes, changes_length))
+			return;
+		fresh.clear();
+		for (uint32_t cell : shadow.opened) {
+			uint8_t& bit = reach.bytes[(cell / width + ByteCells::BORDER) * reach.stride + cell % width + ByteCells::BORDER];
+			if (bit == 0) {
+				bit = 1;
+				fresh.push_back(cell);
+			}
+		}
+		if (fresh.empty())
+			return;
+		opened += fresh.size();
+		for (uint32_t k = 0; k < K; ++k) {
+			// a new cell can also unblock a diagonal between two of its neighbours
+			for (uint32_t cell : fresh) {
+				uint32_t x = cell % width, y = cell / width;
+				for (uint32_t ny = y > 0 ? y - 1 : 0; ny <= std::min(y + 1, height - 1); ++ny)
+				for (uint32_t nx = x > 0 ? x - 1 : 0; nx <= std::min(x + 1, width - 1); ++nx) {
+					uint32_t n = ny * width + nx;
+					uint32_t best = at(n, k);
+					for_each_reach(n, [this,k,&best] (uint32_t m, uint32_t cost) {
+						if (at(m, k) != Node::INV)
+							best = std::min(best, at(m, k) + cost);
+					});
+					if (best < at(n, k)) {
+						at(n, k) = best;
+						queue.emplace(best, n);
+					}
+				}
+			}
+			lowered += propagate(k);
+		}
+	}
+
+	void set_goal(Point g) noexcept
+	{
+		goal = g;
+		const uint32_t* d = &dist[(static_cast<size_t>(g.second) * width + g.first) * K];
+		std::copy(d, d + K, goal_dist.begin());
+	}
+	uint32_t operator()(Point p) const noexcept
+	{
+		uint32_t h = octile(p, goal);
+		const uint32_t* d = &dist[(static_cast<size_t>(p.second) * width + p.first) * K];
+		for (uint32_t k = 0; k < K; ++k) {
+			if (d[k] != Node::INV && goal_dist[k] != Node::INV)
+				h = std::max(h, d[k] > goal_dist[k] ? d[k] - goal_dist[k] : goal_dist[k] - d[k]);
+		}
+		return h;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "landmarks " << K << '\n'
+		    << "landmark_opened_cells " << opened << '\n'
+		    << "landmark_lowered_distances " << lowered << '\n';
+	}
+
+	uint32_t width;
+	uint32_t height;
+	uint64_t key; // map_key of the starting map
+	ByteCells reach; // every cell ever open
+	ShadowMap shadow; // map as of the last change
+	std::array<uint32_t, K> landmarks;
+	std::vector<uint32_t> dist; // K per cell, cell by cell, Node::INV if not reached
+	// query
+	Point goal;
+	std::array<uint32_t, K> goal_dist;
+	// counters
+	size_t opened = 0;
+	size_t lowered = 0;
+
+private:
+	uint32_t& at(uint32_t cell, uint32_t k) noexcept { return dist[static_cast<size_t>(cell) * K + k]; }
+
+	// calls fn(succ, edge_cost) for the successors of cell over the cells ever open
+	template <typename Fn>
+	void for_each_reach(uint32_t cell, Fn&& fn) const
+	{
+		uint32_t x = cell % width, y = cell / width;
+		if (!reach.get(static_cast<int>(x), static_cast<int>(y)))
+			return;
+		for (uint32_t dirs = SUCCESSOR_TABLE[reach.block3(x, y)]; dirs != 0; dirs &= dirs - 1) {
+			uint32_t d = static_cast<uint32_t>(__builtin_ctz(dirs));
+			fn((y + SUCCESSOR_DY[d]) * width + x + SUCCESSOR_DX[d], SUCCESSOR_COST[d]);
+		}
+	}
+	// settles the queued cells of landmark k, @return the cells settled
+	size_t propagate(uint32_t k)
+	{
+		size_t settled = 0;
+		while (!queue.empty()) {
+			auto v = queue.top(); queue.pop();
+			uint32_t cost = v.first, cell = v.second;
+			if (cost != at(cell, k))
+				continue; // stale
+			settled++;
+			for_each_reach(cell, [this,k,cost] (uint32_t succ, uint32_t edge_cost) {
+				if (cost + edge_cost < at(succ, k)) {
+					at(succ, k) = cost + edge_cost;
+					queue.emplace(cost + edge_cost, succ);
+				}
+			});
+		}
+		return settled;
+	}
+	size_t search(uint32_t k, uint32_t origin)
+	{
+		for (size_t cell = 0; cell < static_cast<size_t>(width) * height; ++cell)
+			at(static_cast<uint32_t>(cell), k) = Node::INV;
+		at(origin, k) = 0;
+		queue.emplace(0, origin);
+		return propagate(k);
+	}
+	void build()
+	{
+		uint32_t cells = width * height;
+		dist.assign(static_cast<size_t>(cells) * K, uint32_t{Node::INV});
+		// seed in the largest region, found by searching from unreached cells until no region left can be larger
+		size_t open_cells = 0;
+		for (uint32_t cell = 0; cell < cells; ++cell)
+			open_cells += reach.get(static_cast<int>(cell % width), static_cast<int>(cell / width));
+		uint32_t seed = Node::INV;
+		size_t largest = 0;
+		for (uint32_t cell = 0; cell < cells && open_cells > largest; ++cell) {
+			if (!reach.get(static_cast<int>(cell % width), static_cast<int>(cell / width)) || at(cell, 0) != Node::INV)
+				continue;
+			at(cell, 0) = 0;
+			queue.emplace(0, cell);
+			size_t region = propagate(0);
+			open_cells -= region;
+			if (region > largest) {
+				largest = region;
+				seed = cell;
+			}
+		}
+		if (seed == Node::INV) {
+			landmarks.fill(Node::INV);
+			return; // nothing open
+		}
+		search(0, seed);
+		std::vector<uint32_t> nearest(cells); // to the closest landmark so far, the seed at first
+		for (uint32_t cell = 0; cell < cells; ++cell)
+			nearest[cell] = at(cell, 0);
+		for (uint32_t k = 0; k < K; ++k) {
+			uint32_t far = seed;
+			for (uint32_t cell = 0; cell < cells; ++cell) {
+				if (nearest[cell] != Node::INV && nearest[cell] > nearest[far])
+					far = cell;
+			}
+			landmarks[k] = far;
+			search(k, far);
+			for (uint32_t cell = 0; cell < cells; ++cell)
+				nearest[cell] = k == 0 ? at(cell, k) : std::min(nearest[cell], at(cell, k));
+		}
+	}
+	bool load_index(const char* filename)
+	{
+		FileMapping mapping;
+		std::vector<IndexSection> sections;
+		if (!map_index(mapping, filename, LANDMARK_INDEX_VERSION, key, sections))
+			return false;
+		size_t count = static_cast<size_t>(width) * height * K;
+		if (sections.size() != 2 || sections[0].bytes != K * sizeof(uint32_t) || sections[1].bytes != count * sizeof(uint32_t))
+			return false;
+		const uint32_t* l = static_cast<const uint32_t*>(sections[0].data);
+		std::copy(l, l + K, landmarks.begin());
+		const uint32_t* d = static_cast<const uint32_t*>(sections[1].data);
+		dist.assign(d, d + count);
+		return true;
+	}
+
+	std::vector<uint32_t> fresh; // cells of the last update opened for the first time
+	DijkstraQueue queue;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef OPT_GPPC_INDEX_FILE_HXX
+#define OPT_GPPC_INDEX_FILE_HXX
+
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GPPC_INDEX_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace baseline
+{
+
+/**
+ * Array of trivially copyable T that either owns its storage or views memory owned elsewhere,
+ * e.g. a copy-on-write FileMapping. assign() refills a view of the same size in place, any other
+ * size moves it to owned storage.
+ */
+template <typename T>
+struct MappedArray
+{
+	MappedArray() = default;
+	MappedArray(const MappedArray& other) : owned(other.begin(), other.end()), first(owned.data()), count(owned.size())
+	{ }
+	MappedArray(MappedArray&&) = default; // vector moves keep their buffer
+	MappedArray& operator=(const MappedArray& other)
+	{
+		if (this != &other) {
+			owned.assign(other.begin(), other.end());
+			first = owned.data();
+			count = owned.size();
+		}
+		return *this;
+	}
+	MappedArray& operator=(MappedArray&&) = default;
+
+	void assign(size_t n, const T& value)
+	{
+		if (is_view() && n == count) {
+			std::fill(first, first + n, value);
+			return;
+		}
+		owned.assign(n, value);
+		first = owned.data();
+		count = n;
+	}
+	// views data without copying, data must outlive the view or the next assign
+	void adopt(T* data, size_t n) noexcept
+	{
+		owned = std::vector<T>();
+		first = data;
+		count = n;
+	}
+	bool is_view() const noexcept { return first != owned.data(); }
+
+	T& operator[](size_t i) noexcept { assert(i < count); return first[i]; }
+	const T& operator[](size_t i) const noexcept { assert(i < count); return first[i]; }
+	T& at(size_t i)
+	{
+		if (i >= count)
+			throw std::out_of_range("MappedArray::at");
+		return first[i];
+	}
+	const T& at(size_t i) const
+	{
+		if (i >= count)
+			throw std::out_of_range("MappedArray::at");
+		return first[i];
+	}
+	size_t size() const noexcept { return count; }
+	T* data() noexcept { return first; }
+	const T* data() const noexcept { return first; }
+	T* begin() noexcept { return first; }
+	T* end() noexcept { return first + count; }
+	const T* begin() const noexcept { return first; }
+	const T* end() const noexcept { return first + count; }
+
+private:
+	std::vector<T> owned;
+	T* first = nullptr;
+	size_t count = 0;
+};
+
+/**
+ * Private writable mapping of a whole file, writes are copy-on-write and never reach the file.
+ * allocate() maps anonymous zeroed memory instead, which unmap() hands straight back to the system.
+ */
+struct FileMapping
+{
+	FileMapping() = default;
+	FileMapping(const FileMapping&) = delete;
+	FileMapping& operator=(const FileMapping&) = delete;
+	~FileMapping() { unmap(); }
+
+	bool map(const char* filename)
+	{
+		unmap();
+#ifdef GPPC_INDEX_MMAP
+		int fd = ::open(filename, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				addr = static_cast<unsigned char*>(p);
+				length = static_cast<size_t>(st.st_size);
+			}
+		}
+		::close(fd);
+#else
+		(void)filename;
+#endif
+		return addr != nullptr;
+	}
+	bool allocate(size_t bytes)
+	{
+		unmap();
+#ifdef GPPC_INDEX_MMAP
+		void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p != MAP_FAILED) {
+			addr = static_cast<unsigned char*>(p);
+			length = bytes;
+		}
+#else
+		(void)bytes;
+#endif
+		return addr != nullptr;
+	}
+	void unmap() noexcept
+	{
+#ifdef GPPC_INDEX_MMAP
+		if (addr != nullptr)
+			::munmap(addr, length);
+#endif
+		addr = nullptr;
+		length = 0;
+	}
+
+	unsigned char* addr = nullptr;
+	size_t length = 0;
+};
+
+constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull; // FNV-1a offset basis
+constexpr uint64_t HASH_PRIME = 0x100000001b3ull;
+
+// FNV-1a over 64-bit words, the tail bytes are hashed one at a time
+inline uint64_t hash_bytes(const void* data, size_t bytes, uint64_t h = HASH_SEED) noexcept
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	for (; bytes >= 8; p += 8, bytes -= 8) {
+		uint64_t w;
+		std::memcpy(&w, p, 8);
+		h = (h ^ w) * HASH_PRIME;
+	}
+	for (; bytes > 0; ++p, --bytes)
+		h = (h ^ *p) * HASH_PRIME;
+	return h;
+}
+
+/**
+ * Index file layout: IndexHeader, then each section padded to 8 bytes.
+ * version identifies the section layout of the writer, key ties the file to its input (e.g. a map
+ * hash) and checksum covers everything after the header.
+ */
+constexpr uint32_t INDEX_MAX_SECTIONS = 8;
+struct IndexHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t section_count;
+	uint64_t key;
+	uint64_t checksum;
+	uint64_t section_bytes[INDEX_MAX_SECTIONS];
+};
+constexpr char INDEX_MAGIC[8] = {'G','P','P','C','I','D','X','\0'};
+
+struct IndexSection
+{
+	const void* data;
+	uint64_t bytes;
+};
+
+inline uint64_t index_padded(uint64_t bytes) noexcept
+{
+	return (bytes + 7) & ~uint64_t{7};
+}
+
+// writes sections to filename, creating its directory when missing
+inline bool write_index(const char* filename, uint32_t version, uint64_t key, std::initializer_list<IndexSection> sections)
+{
+	assert(sections.size() <= INDEX_MAX_SECTIONS);
+	IndexHeader header{};
+	std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+	header.version = version;
+	header.section_count = static_cast<uint32_t>(sections.size());
+	header.key = key;
+	const uint64_t zero = 0;
+	uint64_t h = HASH_SEED;
+	uint32_t i = 0;
+	for (const IndexSection& s : sections) {
+		header.section_bytes[i++] = s.bytes;
+		// hashed as laid out in the file, the tail word carries the zero padding
+		size_t full = static_cast<size_t>(s.bytes) & ~size_t{7};
+		h = hash_bytes(s.data, full, h);
+		if (full != s.bytes) {
+			unsigned char tail[8] = {};
+			std::memcpy(tail, static_cast<const unsigned char*>(s.data) + full, static_cast<size_t>(s.bytes) - full);
+			h = hash_bytes(tail, sizeof(tail), h);
+		}
+	}
+	header.checksum = h;
+#ifdef GPPC_INDEX_MMAP
+	if (const char* slash = std::strrchr(filename, '/')) {
+		std::string dir(filename, slash);
+		::mkdir(dir.c_str(), 0755); // fails harmlessly if it exists
+	}
+#endif
+	std::FILE* file = std::fopen(filename, "wb");
+	if (file == nullptr)
+		return false;
+	bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	for (const IndexSection& s : sections) {
+		ok = ok && (s.bytes == 0 || std::fwrite(s.data, static_cast<size_t>(s.bytes), 1, file) == 1);
+		ok = ok && (index_padded(s.bytes) == s.bytes || std::fwrite(&zero, static_cast<size_t>(index_padded(s.bytes) - s.bytes), 1, file) == 1);
+	}
+	return std::fclose(file) == 0 && ok;
+}
+
+/**
+ * Maps filename and validates it against version and key.
+ * On success sections point into mapping, each 8-byte aligned and writable copy-on-write.
+ * @return false if the file is missing, truncated, of another version or key, or fails its checksum.
+ */
+inline bool map_index(FileMapping& mapping, const char* filename, uint32_t version, uint64_t key, std::vector<IndexSection>& sections)
+{
+	sections.clear();
+	if (!mapping.map(filename))
+		return false;
+	IndexHeader header;
+	if (mapping.length < sizeof(header)) {
+		mapping.unmap();
+		return false;
+	}
+	std::memcpy(&header, mapping.addr, sizeof(header));
+	uint64_t total = sizeof(header);
+	if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0 && header.section_count <= INDEX_MAX_SECTIONS) {
+		for (uint32_t i = 0; i < header.section_count && header.section_bytes[i] <= mapping.length; ++i) {
+			sections.push_back(IndexSection{mapping.addr + total, header.section_bytes[i]});
+			total += index_padded(header.section_bytes[i]);
+		}
+	}
+	if (sections.size() != header.section_count || header.version != version || header.key != key || total != mapping.length
+		|| hash_bytes(mapping.addr + sizeof(header), static_cast<size_t>(total - sizeof(header))) != header.checksum) {
+		sections.clear();
+		mapping.unmap();
+		return false;
+	}
+	return true;
+}
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef OPT_GPPC_JUMP_POINT_SEARCH_HXX
+#define OPT_GPPC_JUMP_POINT_SEARCH_HXX
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+#include "AStarSearch.hxx"
+
+namespace baseline
+{
+
+/**
+ * Bit packed rows in gppc_patch layout: cell (c, r) is bit r * len + c, lsb first.
+ * Rows are scanned 56 cells at a time with unaligned 64-bit loads.
+ */
+struct BitRows
+{
+	static constexpr uint32_t WINDOW = 55; // cells scanned per load past the current cell
+	// bit j = cell (c + j, r) for j < 56, rows outside the grid read as blocked
+	uint64_t load(uint32_t r, uint32_t c) const noexcept
+	{
+		if (r >= count)
+			return 0;
+		size_t i = static_cast<size_t>(r) * len + c;
+		size_t b = i >> 3;
+		uint64_t w = 0;
+		if (b + 8 <= bytes)
+			std::memcpy(&w, bits + b, 8);
+		else
+			std::memcpy(&w, bits + b, bytes - b);
+		return (w >> (i & 7)) & ((static_cast<uint64_t>(1) << 56) - 1);
+	}
+
+	const uint8_t* bits;
+	size_t bytes;
+	uint32_t len; // cells per row
+	uint32_t count; // rows
+};
+
+/**
+ * Jumps along row r from column c, forward towards larger columns.
+ * Stops at the first cell that is blocked, has a forced neighbour in row r-1/r+1 or is goal.
+ * @param goal The goal column if goal lies in row r, otherwise Node::INV.
+ * @return Column of the jump point, Node::INV for a dead end.
+ */
+inline uint32_t jump_row(const BitRows& rows, uint32_t r, uint32_t c, bool forward, uint32_t goal) noexcept
+{
+	if (forward) {
+		while (true) {
+			uint32_t n = rows.len - 1 - c;
+			if (n > BitRows::WINDOW)
+				n = BitRows::WINDOW;
+			else if (n == 0)
+				return Node::INV;
+			uint64_t mid = rows.load(r, c), up = rows.load(r-1, c), down = rows.load(r+1, c);
+			// forced when the cell above/below is open but the one behind it is not
+			uint64_t stop = ~mid | (up & ~(up << 1)) | (down & ~(down << 1));
+			if (goal > c && goal - c <= n)
+				stop |= static_cast<uint64_t>(1) << (goal - c);
+			stop &= ((static_cast<uint64_t>(1) << n) - 1) << 1;
+			if (stop != 0) {
+				uint32_t j = static_cast<uint32_t>(__builtin_ctzll(stop));
+				return (mid >> j) & 1 ? c + j : Node::INV;
+			}
+			if (c + n == rows.len - 1)
+				return Node::INV;
+			c += n;
+		}
+	} else {
+		while (true) {
+			uint32_t n = c;
+			if (n > BitRows::WINDOW)
+				n = BitRows::WINDOW;
+			else if (n == 0)
+				return Node::INV;
+			uint32_t base = c - n; // c is bit n
+			uint64_t mid = rows.load(r, base), up = rows.load(r-1, base), down = rows.load(r+1, base);
+			uint64_t stop = ~mid | (up & ~(up >> 1)) | (down & ~(down >> 1));
+			if (goal < c && c - goal <= n)
+				stop |= static_cast<uint64_t>(1) << (goal - base);
+			stop &= (static_cast<uint64_t>(1) << n) - 1;
+			if (stop != 0) {
+				uint32_t j = 63 - static_cast<uint32_t>(__builtin_clzll(stop));
+				return (mid >> j) & 1 ? base + j : Node::INV;
+			}
+			if (base == 0)
+				return Node::INV;
+			c = base;
+		}
+	}
+}
+
+/**
+ * Online Jump Point Search without corner cutting.
+ * Horizontal jumps scan the live bitarray, vertical jumps scan a transposed copy of the map,
+ * which is the only state refreshed on map change.
+ */
+struct JumpPointSearch : Grid
+{
+	JumpPointSearch(gppc_patch map) : Grid(map), shadow(map)
+	{
+		pool.resize(size());
+		// padded so loads never run past the end
+		transposed.assign(static_cast<size_t>(size() + 7) / 8 + 8, 0);
+		update_transposed(0, 0, width, height);
+	}
+	// the transposed copy flips the cells the map flipped
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		if (!shadow.diff(cells, changes, changes_length))
+			return;
+		storage.update(cells, changes, changes_length);
+		for (const std::vector<uint32_t>* flipped : {&shadow.opened, &shadow.closed})
+		for (uint32_t id : *flipped) {
+			Point p = unpack(id);
+			size_t i = static_cast<size_t>(p.first) * height + static_cast<uint32_t>(p.second);
+			transposed[i >> 3] ^= static_cast<uint8_t>(1u << (i & 7));
+		}
+	}
+	void update_transposed(uint32_t x0, uint32_t y0, uint32_t w, uint32_t h)
+	{
+		for (uint32_t x = x0; x < x0 + w; ++x)
+		for (uint32_t y = y0; y < y0 + h; ++y) {
+			size_t i = static_cast<size_t>(x) * height + y;
+			uint8_t bit = static_cast<uint8_t>(1u << (i & 7));
+			if (gppc_patch_get_xy(cells, static_cast<uint16_t>(x), static_cast<uint16_t>(y)))
+				transposed[i >> 3] |= bit;
+			else
+				transposed[i >> 3] &= static_cast<uint8_t>(~bit);
+		}
+	}
+	BitRows rows() const noexcept
+	{
+		return BitRows{cells.bitarray, (static_cast<size_t>(size()) + 7) / 8, width, height};
+	}
+	BitRows columns() const noexcept
+	{
+		return BitRows{transposed.data(), transposed.size(), height, width};
+	}
+
+	std::vector<gppc_point> path;
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		path.clear();
+		expanded = 0;
+		if (!get(s) || !get(g))
+			return false;
+		if (s == g) {
+			// zero path case
+			path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		uint32_t start = pack(s), goal = pack(g);
+		pool.next_search();
+		open.clear();
+		pool[start].g = 0;
+		open.push(open_key(octile(s, g), 0), start);
+		const BitRows R = rows(), C = columns();
+		while (!open.empty()) {
+			uint32_t id = open.pop().second;
+			AStarNode& node = pool[id];
+			if (node.closed)
+				continue; // stale entry
+			if (id == goal) {
+				for (uint32_t at = goal; at != Node::NO_PRED; at = pool[at].pred) {
+					Point p = unpack(at);
+					path.push_back(gppc_point{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)});
+				}
+				std::reverse(path.begin(), path.end());
+				return true;
+			}
+			node.closed = true;
+			expanded++;
+			Point p = unpack(id);
+			uint32_t cost = node.g;
+			auto&& push = [this,id,cost,g] (Point q, uint32_t steps, bool diagonal) {
+				uint32_t qid = pack(q);
+				AStarNode& S = pool[qid];
+				uint32_t qcost = cost + steps * (diagonal ? COST_1 : COST_0);
+				if (qcost < S.g) {
+					S.g = qcost;
+					S.pred = id;
+					open.push(open_key(qcost + octile(q, g), qcost), qid);
+				}
+			};
+			auto&& jump = [&] (int dx, int dy) {
+				if (dy == 0) {
+					uint32_t x = jump_row(R, p.second, p.first, dx > 0, g.second == p.second ? g.first : Node::INV);
+					if (x != Node::INV)
+						push(Point(x, p.second), static_cast<uint32_t>(std::abs(static_cast<int>(x) - p.first)), false);
+				} else if (dx == 0) {
+					uint32_t y = jump_row(C, p.first, p.second, dy > 0, g.first == p.first ? g.second : Node::INV);
+					if (y != Node::INV)
+						push(Point(p.first, y), static_cast<uint32_t>(std::abs(static_cast<int>(y) - p.second)), false);
+				} else {
+					Point q = p;
+					for (uint32_t steps = 1; ; ++steps) {
+						if (!get(Point(q.first + dx, q.second)) || !get(Point(q.first, q.second + dy)) || !get(Point(q.first + dx, q.second + dy)))
+							return;
+						q.first += dx; q.second += dy;
+						if (q == g
+						 || jump_row(R, q.second, q.first, dx > 0, g.second == q.second ? g.first : Node::INV) != Node::INV
+						 || jump_row(C, q.first, q.second, dy > 0, g.first == q.first ? g.second : Node::INV) != Node::INV) {
+							push(q, steps, true);
+							return;
+						}
+					}
+				}
+			};
+			if (node.pred == Node::NO_PRED) {
+				for (int dy = -1; dy < 2; dy++)
+				for (int dx = -1; dx < 2; dx++) {
+					if (dx != 0 || dy != 0)
+						jump(dx, dy);
+				}
+				continue;
+			}
+			Point from = unpack(node.pred);
+			int dx = (p.first > from.first) - (p.first < from.first);
+			int dy = (p.second > from.second) - (p.second < from.second);
+			if (dx != 0 && dy != 0) {
+				jump(dx, 0);
+				jump(0, dy);
+				jump(dx, dy);
+			} else if (dy == 0) {
+				jump(dx, 0);
+				for (int side = -1; side < 2; side += 2) {
+					if (!get(Point(p.first - dx, p.second + side)) && get(Point(p.first, p.second + side))) {
+						jump(0, side);
+						jump(dx, side);
+					}
+				}
+			} else {
+				jump(0, dy);
+				for (int side = -1; side < 2; side += 2) {
+					if (!get(Point(p.first + side, p.second - dy)) && get(Point(p.first + side, p.second))) {
+						jump(side, 0);
+						jump(side, dy);
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	std::vector<uint8_t> transposed;
+	ShadowMap shadow; // map as of the last change
+	NodePool<AStarNode> pool;
+	OpenList open;
+	size_t expanded = 0; // jump points expanded by the last search
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef OPT_GPPC_LPASTAR_SEARCH_HXX
+#define OPT_GPPC_LPASTAR_SEARCH_HXX
+
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#include <limits>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+
+namespace baseline
+{
+
+struct LPANode
+{
+	uint32_t g = Node::INV;
+	uint32_t rhs = Node::INV;
+	bool expanded = false;
+};
+
+/**
+ * Lifelong Planning A* (Koenig et al.) over the live map.
+ * The search of the last (start, goal) pair is kept across gppc_map_change: the cells around every
+ * flipped cell are re-queued, and the next query with the same endpoints only repairs the
+ * inconsistent part of the search instead of starting over.
+ * Any other query starts a fresh search through the generation stamped pool.
+ */
+struct LPAStarSearch : Grid
+{
+	LPAStarSearch(gppc_patch map) : Grid(map), reset_limit(cells_size / 4), shadow(map)
+	{
+		pool.resize(size());
+	}
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		if (!shadow.diff(cells, changes, changes_length))
+			return;
+		storage.update(cells, changes, changes_length);
+		if (!active)
+			return;
+		if (9 * shadow.flips() > reset_limit) {
+			active = false; // cheaper to search again
+			return;
+		}
+		// every edge touching a flipped cell, corners of diagonals included, has both ends within one cell of it
+		touched.clear();
+		for (const std::vector<uint32_t>* flipped : {&shadow.opened, &shadow.closed}) {
+			for (uint32_t id : *flipped) {
+				touched.push_back(id);
+				for_each_neighbour(*this, id, [this] (uint32_t v) { touched.push_back(v); });
+			}
+		}
+		std::sort(touched.begin(), touched.end());
+		touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+		for (uint32_t id : touched)
+			update_vertex(id);
+	}
+
+	std::vector<gppc_point> path;
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		path.clear();
+		queries++;
+		if (!get(s) || !get(g))
+			return false;
+		if (s == g) {
+			// zero path case
+			path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		uint32_t s_id = pack(s), g_id = pack(g);
+		if (!active || s_id != start || g_id != goal) {
+			start = s_id; goal = g_id; goal_point = g;
+			pool.next_search();
+			open.clear();
+			pool[start].rhs = 0;
+			push(start);
+			active = true;
+			fresh++;
+		} else {
+			repaired++;
+		}
+		compute_shortest_path();
+		if (g_of(goal) == Node::INV)
+			return false;
+		// descend the g-values from goal back to start
+		for (uint32_t at = goal; ; ) {
+			Point p = unpack(at);
+			path.push_back(gppc_point{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)});
+			if (at == start)
+				break;
+			uint32_t best = Node::INV, best_cost = Node::INV;
+			for_each_successor(*this, at, [&] (uint32_t pred, uint32_t edge_cost) {
+				uint32_t gp = g_of(pred);
+				if (gp != Node::INV && gp + edge_cost < best_cost) {
+					best_cost = gp + edge_cost;
+					best = pred;
+				}
+			});
+			assert(best != Node::INV && g_of(best) < g_of(at));
+			at = best;
+		}
+		std::reverse(path.begin(), path.end());
+		return true;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "lpa_queries " << queries << "\n"
+		    << "lpa_fresh_searches " << fresh << "\n"
+		    << "lpa_repaired_searches " << repaired << "\n"
+		    << "lpa_expanded " << expanded << "\n"
+		    << "lpa_reexpanded " << reexpanded << std::endl;
+		shadow.print_stats(out);
+	}
+
+	uint32_t g_of(uint32_t id) const noexcept
+	{
+		const LPANode* n = pool.find(id);
+		return n != nullptr ? n->g : Node::INV;
+	}
+	uint64_t key(uint32_t id, const LPANode& n) const noexcept
+	{
+		uint32_t k = std::min(n.g, n.rhs);
+		if (k == Node::INV)
+			return std::numeric_limits<uint64_t>::max();
+		return (static_cast<uint64_t>(k + octile(unpack(id), goal_point)) << 32) | k;
+	}
+	void push(uint32_t id)
+	{
+		const LPANode& n = pool[id];
+		if (n.g != n.rhs)
+			open.push(key(id, n), id);
+	}
+	void update_vertex(uint32_t id)
+	{
+		if (id == start)
+			return;
+		uint32_t rhs = Node::INV;
+		if (get_unbound(id)) {
+			for_each_successor(*this, id, [this,&rhs] (uint32_t pred, uint32_t edge_cost) {
+				uint32_t gp = g_of(pred);
+				if (gp != Node::INV)
+					rhs = std::min(rhs, gp + edge_cost);
+			});
+		}
+		const LPANode* n = pool.find(id);
+		if (n == nullptr && rhs == Node::INV)
+			return; // never reached, stays untouched
+		pool[id].rhs = rhs;
+		push(id);
+	}
+	// pops queue entries that no longer match their node
+	bool clean_top()
+	{
+		while (!open.empty()) {
+			uint32_t id = open.top().second;
+			const LPANode& n = pool[id];
+			if (n.g != n.rhs && open.top().first == key(id, n))
+				return true;
+			open.pop();
+		}
+		return false;
+	}
+	void compute_shortest_path()
+	{
+		while (clean_top()) {
+			const LPANode& goal_node = pool[goal];
+			if (open.top().first >= key(goal, goal_node) && goal_node.g == goal_node.rhs)
+				break;
+			uint32_t id = open.pop().second;
+			LPANode& n = pool[id];
+			expanded++;
+			if (n.expanded)
+				reexpanded++;
+			n.expanded = true;
+			if (n.g > n.rhs) {
+				n.g = n.rhs;
+			} else {
+				n.g = Node::INV;
+				update_vertex(id);
+			}
+			for_each_successor(*this, id, [this] (uint32_t succ, uint32_t) {
+				update_vertex(succ);
+			});
+		}
+	}
+
+	NodePool<LPANode> pool;
+	OpenList open;
+	size_t reset_limit;
+	ShadowMap shadow; // map as of the last change
+	std::vector<uint32_t> touched; // update_grid scratch
+	bool active = false;
+	uint32_t start = Node::INV, goal = Node::INV;
+	Point goal_point;
+	size_t queries = 0, fresh = 0, repaired = 0;
+	size_t expanded = 0, reexpanded = 0;
+};
+
+} // namespace baseline
+
+#endif
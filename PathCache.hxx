@@ -0,0 +1,266 @@
+#ifndef OPT_GPPC_PATH_CACHE_HXX
+#define OPT_GPPC_PATH_CACHE_HXX
+
+#include <vector>
+#include <list>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <ostream>
+#include <cstdint>
+#include "Entry.h"
+#include "BaselineSearch.hxx"
+#include "EngineHooks.hxx"
+
+namespace baseline
+{
+
+constexpr uint32_t CACHE_BLOCK = 16; // side in cells of the blocks cached paths register with
+
+/**
+ * Least recently used paths keyed by (start, goal).
+ * Moves between path points are straight runs and diagonals do not cut corners, so a path relies only
+ * on the cells it passes and the two corners of each diagonal step. Each path registers with the
+ * CACHE_BLOCK blocks holding those cells, and a change evicts the paths registered with the blocks its
+ * patches cover, so its cost follows the patched area rather than the cache size.
+ * Paths that became longer than needed through opened cells are kept.
+ */
+struct PathCache
+{
+	struct Cached
+	{
+		uint64_t key;
+		uint32_t stamp = 0; // bumped whenever the entry is evicted, staling its readers
+		uint32_t reads = 0; // readers registered with the current stamp
+		std::vector<gppc_point> path;
+	};
+	// entry registered with a block by its stamp, stale once the entry is evicted
+	struct Reader
+	{
+		Cached* entry;
+		uint32_t stamp;
+	};
+
+	PathCache(uint16_t width, uint16_t height)
+		: blocks_wide((width + CACHE_BLOCK - 1) / CACHE_BLOCK)
+		, blocks_high((height + CACHE_BLOCK - 1) / CACHE_BLOCK)
+		, readers(static_cast<size_t>(blocks_wide) * blocks_high)
+		, block_seen(readers.size(), 0)
+	{ }
+
+	static uint64_t key(Point s, Point g) noexcept
+	{
+		return static_cast<uint64_t>(static_cast<uint16_t>(s.first)) << 48 | static_cast<uint64_t>(static_cast<uint16_t>(s.second)) << 32
+		     | static_cast<uint64_t>(static_cast<uint16_t>(g.first)) << 16 | static_cast<uint64_t>(static_cast<uint16_t>(g.second));
+	}
+	// path stored for key, marked most recently used, nullptr on a miss
+	const std::vector<gppc_point>* find(uint64_t k)
+	{
+		auto it = index.find(k);
+		if (it == index.end()) {
+			misses++;
+			return nullptr;
+		}
+		hits++;
+		entries.splice(entries.begin(), entries, it->second);
+		return &it->second->path;
+	}
+	// stores a non-empty path for key, dropping the least recently used entry when full
+	void insert(uint64_t k, const std::vector<gppc_point>& path)
+	{
+		if (capacity == 0 || path.empty())
+			return;
+		auto it = index.find(k);
+		if (it != index.end())
+			evict(it->second);
+		if (entries.size() >= capacity) {
+			evict(std::prev(entries.end()));
+			dropped++;
+		}
+		// entries are only moved between lists, so readers may point at them
+		if (spare.empty())
+			entries.emplace_front();
+		else
+			entries.splice(entries.begin(), spare, spare.begin());
+		Cached& c = entries.front();
+		c.key = k;
+		c.path.assign(path.begin(), path.end());
+		index[k] = entries.begin();
+		register_reads(c);
+		compact_if_stale();
+	}
+	// evicts every path registered with a block a patch rectangle covers
+	void invalidate(const gppc_patch* changes, uint32_t changes_length)
+	{
+		for (uint32_t i = 0; i < changes_length; ++i) {
+			const gppc_patch& patch = changes[i];
+			if (patch.width == 0 || patch.height == 0)
+				continue;
+			uint32_t bx1 = std::min<uint32_t>((patch.pos.x + patch.width - 1u) / CACHE_BLOCK, blocks_wide - 1);
+			uint32_t by1 = std::min<uint32_t>((patch.pos.y + patch.height - 1u) / CACHE_BLOCK, blocks_high - 1);
+			for (uint32_t by = patch.pos.y / CACHE_BLOCK; by <= by1; ++by)
+			for (uint32_t bx = patch.pos.x / CACHE_BLOCK; bx <= bx1; ++bx) {
+				std::vector<Reader>& block = readers[static_cast<size_t>(by) * blocks_wide + bx];
+				for (Reader r : block) {
+					if (r.stamp == r.entry->stamp) {
+						evict(index[r.entry->key]);
+						invalidated++;
+					}
+				}
+				// every reader left is stale
+				stale_reads -= block.size();
+				block.clear();
+			}
+		}
+		compact_if_stale();
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "cache_hits " << hits << '\n'
+		    << "cache_misses " << misses << '\n'
+		    << "cache_invalidated " << invalidated << '\n'
+		    << "cache_dropped " << dropped << '\n'
+		    << "cache_block_reads " << live_reads << '\n';
+	}
+
+	size_t capacity = 4096;
+	std::list<Cached> entries; // most recently used first
+	std::list<Cached> spare; // evicted, storage reused by insert
+	std::unordered_map<uint64_t, std::list<Cached>::iterator> index;
+	// counters
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t invalidated = 0;
+	size_t dropped = 0;
+
+private:
+	// moves the entry to spare and makes its readers stale
+	void evict(std::list<Cached>::iterator it)
+	{
+		index.erase(it->key);
+		it->stamp++;
+		stale_reads += it->reads;
+		live_reads -= it->reads;
+		it->reads = 0;
+		spare.splice(spare.begin(), entries, it);
+	}
+	// registers c with the blocks of the cells its path relies on
+	void register_reads(Cached& c)
+	{
+		registered++;
+		auto&& read = [this,&c] (uint32_t x, uint32_t y) {
+			uint32_t b = (y / CACHE_BLOCK) * blocks_wide + x / CACHE_BLOCK;
+			if (block_seen[b] == registered)
+				return;
+			block_seen[b] = registered;
+			readers[b].push_back(Reader{&c, c.stamp});
+			c.reads++;
+			live_reads++;
+		};
+		uint32_t x = c.path.front().x, y = c.path.front().y;
+		read(x, y);
+		for (const gppc_point& p : c.path) {
+			// straight or diagonal run to p, a diagonal step also relies on its two corners
+			while (x != p.x || y != p.y) {
+				uint32_t nx = x + (p.x > x) - (p.x < x), ny = y + (p.y > y) - (p.y < y);
+				if (nx != x && ny != y) {
+					read(nx, y);
+					read(x, ny);
+				}
+				x = nx; y = ny;
+				read(x, y);
+			}
+		}
+	}
+	// drops every stale reader once they outnumber the live ones and the blocks to sweep
+	void compact_if_stale()
+	{
+		if (stale_reads <= live_reads + readers.size())
+			return;
+		for (std::vector<Reader>& block : readers) {
+			block.erase(std::remove_if(block.begin(), block.end(), [] (Reader r) { return r.stamp != r.entry->stamp; }),
+				block.end());
+		}
+		stale_reads = 0;
+	}
+
+	uint32_t blocks_wide, blocks_high;
+	std::vector<std::vector<Reader>> readers; // per block, the entries whose path relies on a cell of it
+	std::vector<uint32_t> block_seen; // registered count of the last path that read each block
+	uint32_t registered = 0;
+	size_t live_reads = 0, stale_reads = 0;
+};
+
+/**
+ * Engine answering repeated queries from a PathCache.
+ * A hit returns the stored path whole without searching. A miss searches with Engine, the parts of a
+ * streamed path are collected across calls and the complete path is stored once the last is returned.
+ * Queries without a path are not stored, any change could connect them.
+ */
+template <typename Engine>
+struct CachedSearch : Engine
+{
+	CachedSearch(gppc_patch map) : Engine(map), cache(map.width, map.height)
+	{ }
+	// for engines that read an index
+	template <typename E = Engine, typename = decltype(E(std::declval<gppc_patch>(), std::declval<const char*>()))>
+	CachedSearch(gppc_patch map, const char* index_file) : Engine(map, index_file), cache(map.width, map.height)
+	{ }
+
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		cache.invalidate(changes, changes_length);
+		hit = nullptr;
+		streaming = false;
+		Engine::update_grid(changes, changes_length);
+	}
+	const std::vector<gppc_point>& get_path() const noexcept { return hit != nullptr ? *hit : Engine::get_path(); }
+	bool incomplete() const noexcept { return hit == nullptr && baseline::is_incomplete(static_cast<const Engine&>(*this), 0); }
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		uint64_t k = PathCache::key(s, g);
+		if (!streaming || k != query_key) {
+			streaming = false;
+			streamed.clear();
+			if ((hit = cache.find(k)) != nullptr)
+				return true;
+		}
+		hit = nullptr;
+		if (!Engine::search(s, g)) {
+			streaming = false;
+			return false;
+		}
+		// join the part, its first point may repeat the end of the previous one
+		const std::vector<gppc_point>& part = Engine::get_path();
+		auto from = part.begin();
+		if (!streamed.empty() && from != part.end() && from->x == streamed.back().x && from->y == streamed.back().y)
+			++from;
+		streamed.insert(streamed.end(), from, part.end());
+		streaming = baseline::is_incomplete(static_cast<const Engine&>(*this), 0);
+		query_key = k;
+		if (!streaming)
+			cache.insert(k, streamed);
+		return true;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		cache.print_stats(out);
+		baseline::print_stats(static_cast<const Engine&>(*this), out, 0);
+	}
+
+	PathCache cache;
+
+private:
+	const std::vector<gppc_point>* hit = nullptr; // path returned by the last call, if it came from cache
+	std::vector<gppc_point> streamed; // parts of the current query returned so far
+	uint64_t query_key = 0;
+	bool streaming = false;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef OPT_GPPC_RADIX_HEAP_HXX
+#define OPT_GPPC_RADIX_HEAP_HXX
+
+#include <vector>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+namespace baseline
+{
+
+/**
+ * Monotone radix heap over 32-bit keys (Ahuja et al.).
+ * Keys pushed must not be smaller than the last key popped, which holds for dijkstra as every
+ * edge cost (COST_0/COST_1) is positive. Bucket i holds keys whose highest bit differing from the
+ * last popped key is bit i-1, so a key moves down at most 32 times between push and pop.
+ * Bucket storage is kept when emptied, reusing the heap costs no allocation.
+ * Interface mirrors the std::priority_queue calls used by dijkstra_relax.
+ */
+template <typename Value>
+struct RadixHeap
+{
+	using value_type = std::pair<uint32_t, Value>;
+	bool empty() const noexcept { return count == 0; }
+	size_t size() const noexcept { return count; }
+	void clear() noexcept
+	{
+		for (auto& bucket : buckets)
+			bucket.clear();
+		count = 0;
+		last = 0;
+	}
+	void emplace(uint32_t key, Value value)
+	{
+		if (count == 0)
+			last = 0; // previous run finished, restart the monotone range
+		assert(key >= last);
+		buckets[bucket_of(key)].emplace_back(key, value);
+		count++;
+	}
+	const value_type& top()
+	{
+		assert(count != 0);
+		if (buckets[0].empty())
+			refill();
+		return buckets[0].back();
+	}
+	void pop()
+	{
+		assert(count != 0);
+		if (buckets[0].empty())
+			refill();
+		buckets[0].pop_back();
+		count--;
+	}
+
+private:
+	size_t bucket_of(uint32_t key) const noexcept
+	{
+		return key == last ? 0 : 32 - static_cast<size_t>(__builtin_clz(key ^ last));
+	}
+	// moves the smallest non-empty bucket down, its minimum becomes last
+	void refill()
+	{
+		size_t i = 1;
+		while (buckets[i].empty())
+			i++;
+		auto& bucket = buckets[i];
+		last = std::min_element(bucket.begin(), bucket.end())->first;
+		for (const value_type& v : bucket)
+			buckets[bucket_of(v.first)].push_back(v);
+		bucket.clear();
+	}
+
+	std::array<std::vector<value_type>, 33> buckets;
+	uint32_t last = 0;
+	size_t count = 0;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef OPT_GPPC_SEARCH_POOL_HXX
+#define OPT_GPPC_SEARCH_POOL_HXX
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+#include <cassert>
+#include "BaselineSearch.hxx"
+
+namespace baseline
+{
+
+/**
+ * Grid sized storage of per-query search nodes.
+ * Every entry carries the generation of the search that last touched it, next_search() bumps the
+ * generation so entries of older searches read as fresh nodes without clearing the pool.
+ */
+template <typename SearchNode>
+struct NodePool
+{
+	void resize(size_t count)
+	{
+		entries.assign(count, Entry{0, SearchNode{}});
+		generation = 0;
+	}
+	void next_search() noexcept
+	{
+		if (++generation == 0) {
+			// wrapped, old stamps could alias the new generation
+			for (Entry& e : entries)
+				e.generation = 0;
+			generation = 1;
+		}
+	}
+	bool contains(uint32_t id) const noexcept
+	{
+		assert(id < entries.size());
+		return entries[id].generation == generation;
+	}
+	// node id of the current search, nullptr if not generated yet
+	const SearchNode* find(uint32_t id) const noexcept
+	{
+		assert(id < entries.size());
+		return entries[id].generation == generation ? &entries[id].node : nullptr;
+	}
+	// node id of the current search, value-initialised on first access
+	SearchNode& operator[](uint32_t id) noexcept
+	{
+		assert(id < entries.size());
+		Entry& e = entries[id];
+		if (e.generation != generation) {
+			e.generation = generation;
+			e.node = SearchNode{};
+		}
+		return e.node;
+	}
+	size_t size() const noexcept { return entries.size(); }
+
+	struct Entry
+	{
+		uint32_t generation;
+		SearchNode node;
+	};
+	std::vector<Entry> entries;
+	uint32_t generation = 0;
+};
+
+/**
+ * Binary min-heap of (key, node-id) with lazy deletion, storage is kept between queries.
+ */
+struct OpenList
+{
+	using value_type = std::pair<uint64_t, uint32_t>;
+	bool empty() const noexcept { return heap.empty(); }
+	size_t size() const noexcept { return heap.size(); }
+	void clear() noexcept { heap.clear(); }
+	void push(uint64_t key, uint32_t id)
+	{
+		heap.emplace_back(key, id);
+		std::push_heap(heap.begin(), heap.end(), std::greater<value_type>());
+	}
+	const value_type& top() const noexcept { return heap.front(); }
+	value_type pop()
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<value_type>());
+		value_type v = heap.back();
+		heap.pop_back();
+		return v;
+	}
+	std::vector<value_type> heap;
+};
+
+// f-value key ordering ties on larger g first
+inline uint64_t open_key(uint32_t f, uint32_t g) noexcept
+{
+	return (static_cast<uint64_t>(f) << 32) | static_cast<uint32_t>(~g);
+}
+
+// octile distance in COST_0/COST_1 units
+inline uint32_t octile(Point a, Point b) noexcept
+{
+	uint32_t dx = static_cast<uint32_t>(std::abs(a.first - b.first));
+	uint32_t dy = static_cast<uint32_t>(std::abs(a.second - b.second));
+	if (dx < dy)
+		std::swap(dx, dy);
+	return COST_0 * (dx - dy) + COST_1 * dy;
+}
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,359 @@
+#ifndef OPT_GPPC_SECTOR_SEARCH_HXX
+#define OPT_GPPC_SECTOR_SEARCH_HXX
+
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+#include "AStarSearch.hxx"
+
+namespace baseline
+{
+
+constexpr uint32_t SECTOR = 32; // sector side in cells
+constexpr uint32_t ENTRANCE_SPLIT = 6; // border runs this wide get a transition at both ends
+
+/**
+ * Entrances of one sector and their shortest distances moving only through the sector.
+ */
+struct Sector
+{
+	std::vector<uint32_t> entrances; // cell ids
+	std::vector<uint32_t> dist; // entrances.size() squared, Node::INV if not connected inside the sector
+};
+
+/**
+ * Hierarchical search over SECTOR x SECTOR sectors (HPA*).
+ * Each maximal run of open cell pairs along a sector border places a transition in the middle, or at
+ * both ends for wide runs. The abstract graph joins a sector's entrances by their in-sector distances
+ * and transitions by a cardinal step, so it connects exactly what the grid connects.
+ * A map change rebuilds only the sectors within a cell of a flipped cell, the borders included.
+ * Queries search the abstract graph, then refine it one abstract edge at a time: every call returns
+ * the next refined segments and sets incomplete() until the goal is emitted.
+ * Paths are not optimal.
+ */
+struct SectorSearch : Grid
+{
+	SectorSearch(gppc_patch map) : Grid(map)
+		,sectors_wide((width + SECTOR - 1) / SECTOR)
+		,sectors_high((height + SECTOR - 1) / SECTOR)
+		,sectors(sectors_wide * sectors_high)
+		,entrance_index(size(), uint32_t{Node::INV})
+		,local(SECTOR * SECTOR)
+		,shadow(map)
+	{
+		pool.resize(size());
+		for (uint32_t i = 0; i < sectors.size(); ++i)
+			rebuild(i);
+	}
+	// rebuilds every sector a flipped cell or the borders next to it touch
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		streaming = false;
+		if (!shadow.diff(cells, changes, changes_length))
+			return;
+		storage.update(cells, changes, changes_length);
+		std::vector<uint32_t> dirty;
+		std::vector<bool> marked(sectors.size());
+		for (const std::vector<uint32_t>* flipped : {&shadow.opened, &shadow.closed})
+		for (uint32_t cell : *flipped) {
+			Point p = unpack(cell);
+			uint32_t x = static_cast<uint32_t>(p.first), y = static_cast<uint32_t>(p.second);
+			uint32_t x0 = x > 0 ? x - 1u : 0u, y0 = y > 0 ? y - 1u : 0u;
+			uint32_t x1 = std::min<uint32_t>(x + 1u, width - 1), y1 = std::min<uint32_t>(y + 1u, height - 1);
+			for (uint32_t sy = y0 / SECTOR; sy <= y1 / SECTOR; ++sy)
+			for (uint32_t sx = x0 / SECTOR; sx <= x1 / SECTOR; ++sx) {
+				uint32_t id = sy * sectors_wide + sx;
+				if (!marked[id]) {
+					marked[id] = true;
+					dirty.push_back(id);
+				}
+			}
+		}
+		for (uint32_t id : dirty)
+			rebuild(id);
+	}
+
+	std::vector<gppc_point> path;
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	// last returned path is a prefix, search must be called again with the same query
+	bool incomplete() const noexcept { return streaming; }
+	// bool search found a path, continues the refinement of an incomplete query
+	bool search(Point s, Point g)
+	{
+		if (streaming && s == query_start && g == query_goal) {
+			refine_segments();
+			return true;
+		}
+		streaming = false;
+		path.clear();
+		if (!get(s) || !get(g))
+			return false;
+		queries++;
+		if (s == g) {
+			// zero path case
+			path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		if (!abstract_search(pack(s), pack(g)))
+			return false;
+		query_start = s; query_goal = g;
+		route_at = 0;
+		push_back(route.front());
+		refine_segments();
+		return true;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		size_t entrances = 0;
+		for (const Sector& S : sectors)
+			entrances += S.entrances.size();
+		out << "hpa_sectors " << sectors.size() << '\n'
+		    << "hpa_entrances " << entrances << '\n'
+		    << "hpa_sectors_rebuilt " << sectors_rebuilt << '\n'
+		    << "hpa_queries " << queries << '\n'
+		    << "hpa_abstract_expanded " << abstract_expanded << '\n'
+		    << "hpa_refined_edges " << refined_edges << '\n';
+		shadow.print_stats(out);
+	}
+
+	uint32_t sector_of(uint32_t cell) const noexcept
+	{
+		Point p = unpack(cell);
+		return (static_cast<uint32_t>(p.second) / SECTOR) * sectors_wide + static_cast<uint32_t>(p.first) / SECTOR;
+	}
+
+protected:
+	struct Box
+	{
+		uint32_t x0, y0, x1, y1; // half open
+	};
+	Box bounds(uint32_t sector) const noexcept
+	{
+		uint32_t x0 = (sector % sectors_wide) * SECTOR, y0 = (sector / sectors_wide) * SECTOR;
+		return Box{x0, y0, std::min(x0 + SECTOR, width), std::min(y0 + SECTOR, height)};
+	}
+	uint32_t local_index(const Box& box, uint32_t cell) const noexcept
+	{
+		Point p = unpack(cell);
+		return (static_cast<uint32_t>(p.second) - box.y0) * SECTOR + (static_cast<uint32_t>(p.first) - box.x0);
+	}
+
+	// dijkstra from origin through the cells of sector into local, stops once target is settled
+	void sector_dijkstra(uint32_t sector, uint32_t origin, uint32_t target = Node::INV)
+	{
+		Box box = bounds(sector);
+		local.assign(local.size(), Node{Node::INV, Node::INV});
+		local[local_index(box, origin)] = Node{Node::NO_PRED, 0};
+		assert(queue.empty());
+		queue.emplace(0, origin);
+		while (!queue.empty()) {
+			auto node_value = queue.top(); queue.pop();
+			uint32_t cost = node_value.first, id = node_value.second;
+			if (cost != local[local_index(box, id)].cost)
+				continue; // stale
+			if (id == target) {
+				queue.clear();
+				break;
+			}
+			for_each_successor(*this, id, [this,&box,id,cost](uint32_t succ, uint32_t edge_cost) {
+				Point q = unpack(succ);
+				if (static_cast<uint32_t>(q.first) - box.x0 >= box.x1 - box.x0 || static_cast<uint32_t>(q.second) - box.y0 >= box.y1 - box.y0)
+					return; // outside the sector
+				Node& N = local[local_index(box, succ)];
+				if (cost + edge_cost < N.cost) {
+					N = Node{id, cost + edge_cost};
+					queue.emplace(cost + edge_cost, succ);
+				}
+			});
+		}
+	}
+
+	void add_entrance(Sector& S, uint32_t cell)
+	{
+		if (entrance_index[cell] == Node::INV) {
+			entrance_index[cell] = static_cast<uint32_t>(S.entrances.size());
+			S.entrances.push_back(cell);
+		}
+	}
+	// places the transitions of one sector side: first is the first inside cell, step walks along the
+	// side and across is the offset to the neighbouring sector's cell
+	void place_side(Sector& S, uint32_t first, uint32_t step, uint32_t across, uint32_t count)
+	{
+		uint32_t run = 0;
+		for (uint32_t i = 0; i <= count; ++i) {
+			uint32_t cell = first + i * step;
+			if (i < count && get_unbound(cell) && get_unbound(cell + across)) {
+				run++;
+				continue;
+			}
+			if (run == 0)
+				continue;
+			uint32_t lo = i - run, hi = i - 1;
+			if (run < ENTRANCE_SPLIT) {
+				add_entrance(S, first + (lo + hi) / 2 * step);
+			} else {
+				add_entrance(S, first + lo * step);
+				add_entrance(S, first + hi * step);
+			}
+			run = 0;
+		}
+	}
+	// recomputes the entrances of sector and the distances between them
+	void rebuild(uint32_t sector)
+	{
+		Sector& S = sectors[sector];
+		for (uint32_t e : S.entrances)
+			entrance_index[e] = Node::INV;
+		S.entrances.clear();
+		Box box = bounds(sector);
+		if (box.y0 > 0)
+			place_side(S, pack(Point(box.x0, box.y0)), 1, -width, box.x1 - box.x0);
+		if (box.y1 < height)
+			place_side(S, pack(Point(box.x0, box.y1 - 1)), 1, width, box.x1 - box.x0);
+		if (box.x0 > 0)
+			place_side(S, pack(Point(box.x0, box.y0)), width, -1u, box.y1 - box.y0);
+		if (box.x1 < width)
+			place_side(S, pack(Point(box.x1 - 1, box.y0)), width, 1, box.y1 - box.y0);
+		size_t k = S.entrances.size();
+		S.dist.assign(k * k, uint32_t{Node::INV});
+		for (size_t i = 0; i < k; ++i) {
+			sector_dijkstra(sector, S.entrances[i]);
+			for (size_t j = 0; j < k; ++j)
+				S.dist[i * k + j] = local[local_index(box, S.entrances[j])].cost;
+		}
+		sectors_rebuilt++;
+	}
+
+	// A* over the sector entrances with start and goal linked into their sectors, fills route
+	bool abstract_search(uint32_t start, uint32_t goal)
+	{
+		uint32_t start_sector = sector_of(start), goal_sector = sector_of(goal);
+		// goal distances first, the start dijkstra leaves local holding the start sector
+		Box goal_box = bounds(goal_sector);
+		const Sector& G = sectors[goal_sector];
+		sector_dijkstra(goal_sector, goal);
+		goal_dist.resize(G.entrances.size());
+		for (size_t j = 0; j < G.entrances.size(); ++j)
+			goal_dist[j] = local[local_index(goal_box, G.entrances[j])].cost;
+		Box start_box = bounds(start_sector);
+		sector_dijkstra(start_sector, start);
+
+		Point g = unpack(goal);
+		pool.next_search();
+		open.clear();
+		pool[start].g = 0;
+		open.push(open_key(octile(unpack(start), g), 0), start);
+		auto&& relax = [this,g] (uint32_t id, uint32_t cost, uint32_t succ, uint32_t edge_cost) {
+			if (edge_cost == Node::INV)
+				return;
+			AStarNode& S = pool[succ];
+			if (cost + edge_cost < S.g) {
+				S.g = cost + edge_cost;
+				S.pred = id;
+				open.push(open_key(S.g + octile(unpack(succ), g), S.g), succ);
+			}
+		};
+		while (!open.empty()) {
+			uint32_t id = open.pop().second;
+			AStarNode& node = pool[id];
+			if (node.closed)
+				continue; // stale entry
+			if (id == goal) {
+				route.clear();
+				for (uint32_t at = goal; at != Node::NO_PRED; at = pool[at].pred)
+					route.push_back(at);
+				std::reverse(route.begin(), route.end());
+				return true;
+			}
+			node.closed = true;
+			abstract_expanded++;
+			uint32_t cost = node.g;
+			uint32_t sector = sector_of(id);
+			const Sector& S = sectors[sector];
+			uint32_t index = entrance_index[id];
+			if (id == start) {
+				for (uint32_t e : S.entrances)
+					relax(id, cost, e, local[local_index(start_box, e)].cost);
+				if (sector == goal_sector)
+					relax(id, cost, goal, local[local_index(start_box, goal)].cost);
+			} else if (index != Node::INV) {
+				size_t k = S.entrances.size();
+				for (size_t j = 0; j < k; ++j)
+					relax(id, cost, S.entrances[j], S.dist[index * k + j]);
+				if (sector == goal_sector)
+					relax(id, cost, goal, goal_dist[index]);
+			}
+			if (index != Node::INV) {
+				// transitions step straight across the border
+				for_each_successor(*this, id, [&](uint32_t succ, uint32_t edge_cost) {
+					if (edge_cost == COST_0 && entrance_index[succ] != Node::INV && sector_of(succ) != sector)
+						relax(id, cost, succ, edge_cost);
+				});
+			}
+		}
+		return false;
+	}
+
+	void push_back(uint32_t cell)
+	{
+		Point p = unpack(cell);
+		path.push_back(gppc_point{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)});
+	}
+	// appends the cells after a up to b, a and b are either in one sector or a transition apart
+	void refine(uint32_t a, uint32_t b)
+	{
+		uint32_t sector = sector_of(a);
+		if (sector != sector_of(b)) {
+			push_back(b);
+			return;
+		}
+		// searched from b so preds lead from a towards b
+		sector_dijkstra(sector, b, a);
+		Box box = bounds(sector);
+		for (uint32_t at = a; at != b; ) {
+			at = local[local_index(box, at)].pred;
+			push_back(at);
+		}
+	}
+	// replaces path with the next refined abstract edges, at least a sector side of cells when possible
+	void refine_segments()
+	{
+		if (route_at != 0)
+			path.clear();
+		while (route_at + 1 < route.size() && path.size() < SECTOR) {
+			refine(route[route_at], route[route_at + 1]);
+			route_at++;
+			refined_edges++;
+		}
+		streaming = route_at + 1 < route.size();
+	}
+
+	uint32_t sectors_wide;
+	uint32_t sectors_high;
+	std::vector<Sector> sectors;
+	std::vector<uint32_t> entrance_index; // index into its sector's entrances, Node::INV if not an entrance
+	std::vector<Node> local; // sector_dijkstra result, indexed by local_index
+	ShadowMap shadow; // map as of the last change
+	DijkstraQueue queue;
+	std::vector<uint32_t> goal_dist; // goal to the goal sector entrances
+	NodePool<AStarNode> pool;
+	OpenList open;
+	// streamed query
+	std::vector<uint32_t> route; // abstract path, start to goal
+	size_t route_at = 0; // route entries refined so far
+	Point query_start, query_goal;
+	bool streaming = false;
+	// counters
+	size_t sectors_rebuilt = 0;
+	size_t queries = 0;
+	size_t abstract_expanded = 0;
+	size_t refined_edges = 0;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef OPT_GPPC_SHADOW_MAP_HXX
+#define OPT_GPPC_SHADOW_MAP_HXX
+
+#include <vector>
+#include <ostream>
+#include <cstring>
+#include <cstdint>
+#include "Entry.h"
+
+namespace baseline
+{
+
+/**
+ * Copy of the harness bitarray as of the last change, with the same bit order.
+ * The harness overwrites its map before gppc_map_change, diff() recovers which cells flipped: each
+ * row of a patch rectangle is a bit range at the same offset in both arrays, so it is XORed against
+ * the live map 64 cells at a time, and only set bits of the XOR are listed. Rows a patch rewrote
+ * without flipping anything cost one load and compare per word.
+ */
+struct ShadowMap
+{
+	ShadowMap() = default;
+	explicit ShadowMap(gppc_patch map)
+	{
+		load(map);
+	}
+	void load(gppc_patch map)
+	{
+		width = map.width;
+		bytes = (static_cast<size_t>(map.width) * map.height + 7) / 8;
+		words.assign((bytes + 7) / 8, 0);
+		std::memcpy(words.data(), map.bitarray, bytes);
+		opened.clear(); closed.clear();
+	}
+	/**
+	 * Lists the cells under the patch rectangles that differ from the copy in opened and closed,
+	 * by id y * width + x patch by patch and row by row, and brings the copy up to date.
+	 * map must already hold the changes.
+	 * @return true if any cell flipped.
+	 */
+	bool diff(gppc_patch map, const gppc_patch* changes, uint32_t changes_length)
+	{
+		opened.clear(); closed.clear();
+		for (uint32_t i = 0; i < changes_length; ++i) {
+			const gppc_patch& patch = changes[i];
+			patched += static_cast<size_t>(patch.width) * patch.height;
+			for (uint32_t y = patch.pos.y, ye = y + patch.height; y < ye; ++y)
+				diff_run(map.bitarray, static_cast<size_t>(y) * width + patch.pos.x, patch.width);
+		}
+		flipped += opened.size() + closed.size();
+		return !opened.empty() || !closed.empty();
+	}
+	size_t flips() const noexcept { return opened.size() + closed.size(); }
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "shadow_patched_cells " << patched << '\n'
+		    << "shadow_flipped_cells " << flipped << '\n';
+	}
+
+	uint32_t width = 0;
+	size_t bytes = 0; // of the harness bitarray
+	std::vector<uint64_t> words;
+	std::vector<uint32_t> opened, closed; // cells of the last diff
+	// counters
+	size_t patched = 0;
+	size_t flipped = 0;
+
+private:
+	// word k of the harness bitarray, bytes past its end read as 0
+	uint64_t live_word(const uint8_t* live, size_t k) const noexcept
+	{
+		uint64_t w = 0;
+		size_t at = k * 8;
+		std::memcpy(&w, live + at, at + 8 <= bytes ? 8 : bytes - at);
+		return w;
+	}
+	void diff_run(const uint8_t* live, size_t first, uint32_t count)
+	{
+		size_t end = first + count;
+		for (size_t k = first / 64, ke = (end + 63) / 64; k < ke; ++k) {
+			uint64_t mask = ~uint64_t{0};
+			if (k == first / 64)
+				mask &= ~uint64_t{0} << (first % 64);
+			if (k == ke - 1 && end % 64 != 0)
+				mask &= (uint64_t{1} << (end % 64)) - 1;
+			uint64_t now = live_word(live, k);
+			uint64_t flip = (words[k] ^ now) & mask;
+			if (flip == 0)
+				continue;
+			words[k] ^= flip;
+			uint32_t base = static_cast<uint32_t>(k * 64);
+			for (uint64_t f = flip & now; f != 0; f &= f - 1)
+				opened.push_back(base + static_cast<uint32_t>(__builtin_ctzll(f)));
+			for (uint64_t f = flip & ~now; f != 0; f &= f - 1)
+				closed.push_back(base + static_cast<uint32_t>(__builtin_ctzll(f)));
+		}
+	}
+};
+
+} // namespace baseline
+
+#endif
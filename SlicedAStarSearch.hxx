@@ -0,0 +1,209 @@
+#ifndef OPT_GPPC_SLICED_ASTAR_SEARCH_HXX
+#define OPT_GPPC_SLICED_ASTAR_SEARCH_HXX
+
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include <cassert>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+#include "AStarSearch.hxx"
+
+namespace baseline
+{
+
+constexpr uint32_t SLICE_CLOCK_INTERVAL = 256; // expansions between reads of the clock
+
+/**
+ * A* suspended between gppc_get_path calls once a call has spent its budget.
+ * The open list and pool stay as they are between calls, each call expands at most expansion_budget
+ * nodes for at most time_budget, then commits at least one move and sets incomplete(). While the pred chain
+ * of the best open node passes through the committed tip, the tip advances at most commit_moves cells down
+ * that chain, otherwise it steps one cell back along the prefix towards where the chain joins it. Once the
+ * goal is settled the tip walks back along the prefix to where the goal's preds join it, so the query's path
+ * stays valid at the cost of optimality, the few moves per call keeping the cells walked back few.
+ * Connected components of the map are relabelled on every change, a query without a path is
+ * rejected before anything is committed.
+ */
+struct SlicedAStarSearch : Grid
+{
+	SlicedAStarSearch(gppc_patch map) : Grid(map), on_prefix(size(), uint32_t{Node::INV}), shadow(map)
+	{
+		pool.resize(size());
+		label_components(*this);
+	}
+	// relabels the components unless the patches left every cell as it was
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		if (!shadow.diff(cells, changes, changes_length))
+			return;
+		storage.update(cells, changes, changes_length);
+		abandon();
+		label_components(*this);
+	}
+
+	size_t expansion_budget = 16384; // per call, at least one
+	size_t commit_moves = 1; // per call down the chain of the best open node, at least one
+	std::chrono::microseconds time_budget{1000}; // per call, zero for no limit
+	std::vector<gppc_point> path;
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	// last returned path is a prefix, search must be called again with the same query
+	bool incomplete() const noexcept { return streaming; }
+	// bool search found a path, resumes the suspended search of an incomplete query
+	bool search(Point s, Point g)
+	{
+		path.clear();
+		if (!streaming || s != query_start || g != query_goal) {
+			abandon();
+			if (!get(s) || !get(g) || !components.connected(pack(s), pack(g)))
+				return false;
+			queries++;
+			if (s == g) {
+				// zero path case
+				path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+					gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+				return true;
+			}
+			uint32_t start = pack(s);
+			goal = pack(g);
+			pool.next_search();
+			open.clear();
+			pool[start].g = 0;
+			open.push(open_key(octile(s, g), 0), start);
+			on_prefix[start] = 0;
+			prefix.push_back(start);
+			push_back(start);
+			query_start = s; query_goal = g;
+			streaming = true;
+		}
+		slices++;
+		uint32_t target = expand_slice();
+		if (target == goal) {
+			commit(goal, Node::INV);
+			abandon();
+		} else if (!advance(target))
+			retreat();
+
+		assert(!path.empty());
+		return true;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		out << "sliced_queries " << queries << '\n'
+		    << "sliced_slices " << slices << '\n'
+		    << "sliced_expanded " << expanded << '\n'
+		    << "sliced_backtracked " << backtracked << '\n';
+	}
+
+protected:
+	// expands within the budget, returns goal once it is settled or else the best open node
+	uint32_t expand_slice()
+	{
+		auto deadline = std::chrono::steady_clock::now() + time_budget;
+		Point g = unpack(goal);
+		for (size_t n = 0; ; ) {
+			assert(!open.empty()); // goal is connected
+			uint32_t id = open.top().second;
+			AStarNode& node = pool[id];
+			if (node.closed) {
+				open.pop();
+				continue; // stale entry
+			}
+			if (id == goal)
+				return goal;
+			if (n != 0 && (n >= expansion_budget
+				|| (n % SLICE_CLOCK_INTERVAL == 0 && time_budget.count() != 0 && std::chrono::steady_clock::now() >= deadline)))
+				return id;
+			open.pop();
+			node.closed = true;
+			n++;
+			expanded++;
+			uint32_t cost = node.g;
+			for_each_successor(*this, id, [this,id,cost,g](uint32_t succ, uint32_t edge_cost) {
+				AStarNode& S = pool[succ];
+				if (cost + edge_cost < S.g) {
+					S.g = cost + edge_cost;
+					S.pred = id;
+					open.push(open_key(S.g + octile(unpack(succ), g), S.g), succ);
+				}
+			});
+		}
+	}
+
+	// moves the committed tip up to commit_moves cells towards target if target's preds pass through the tip
+	bool advance(uint32_t target)
+	{
+		uint32_t at = target;
+		for (; on_prefix[at] == Node::INV; at = pool[at].pred)
+			;
+		if (at != prefix.back())
+			return false;
+		commit(target, commit_moves);
+		return true;
+	}
+	// moves the committed tip back along the prefix to where target's preds join it, then at most moves cells down to target
+	void commit(uint32_t target, size_t moves)
+	{
+		chain.clear();
+		uint32_t at = target;
+		for (; on_prefix[at] == Node::INV; at = pool[at].pred)
+			chain.push_back(at);
+		size_t join = on_prefix[at];
+		while (prefix.size() > join + 1) {
+			on_prefix[prefix.back()] = Node::INV;
+			prefix.pop_back();
+			push_back(prefix.back());
+			backtracked++;
+		}
+		for (auto it = chain.rbegin(); it != chain.rend() && moves-- != 0; ++it) {
+			on_prefix[*it] = static_cast<uint32_t>(prefix.size());
+			prefix.push_back(*it);
+			push_back(*it);
+		}
+	}
+	// moves the committed tip one cell back along the prefix, the best open node's preds join it further back
+	void retreat()
+	{
+		assert(prefix.size() > 1);
+		on_prefix[prefix.back()] = Node::INV;
+		prefix.pop_back();
+		push_back(prefix.back());
+		backtracked++;
+	}
+	// drops the suspended query
+	void abandon()
+	{
+		for (uint32_t id : prefix)
+			on_prefix[id] = Node::INV;
+		prefix.clear();
+		streaming = false;
+	}
+
+	void push_back(uint32_t cell)
+	{
+		Point p = unpack(cell);
+		path.push_back(gppc_point{static_cast<uint16_t>(p.first), static_cast<uint16_t>(p.second)});
+	}
+
+	NodePool<AStarNode> pool;
+	OpenList open;
+	// suspended query
+	std::vector<uint32_t> prefix; // committed cells from start without the walked back ones
+	std::vector<uint32_t> on_prefix; // index into prefix, Node::INV if not on it
+	std::vector<uint32_t> chain; // commit scratch
+	ShadowMap shadow; // map as of the last change
+	uint32_t goal = 0;
+	Point query_start, query_goal;
+	bool streaming = false;
+	// counters
+	size_t queries = 0;
+	size_t slices = 0;
+	size_t expanded = 0;
+	size_t backtracked = 0;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,542 @@
+#ifndef OPT_GPPC_SUBGOAL_GRAPH_SEARCH_HXX
+#define OPT_GPPC_SUBGOAL_GRAPH_SEARCH_HXX
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <cstdint>
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+
+namespace baseline
+{
+
+constexpr uint32_t DIRTY_BLOCK = 8; // side in cells of the blocks edge searches register their reads with
+// bumped whenever the section order or layout of the subgoal index change
+constexpr uint32_t SUBGOAL_INDEX_VERSION = 2;
+
+struct SubgoalNode
+{
+	uint32_t g = Node::INV;
+	uint32_t pred = Node::NO_PRED;
+	bool closed = false;
+	bool to_goal = false; // the query goal is directly h-reachable
+};
+
+/**
+ * Optimal search over a simple subgoal graph.
+ * Subgoals are the open cells diagonal to a blocked cell whose two cardinal neighbours towards it are open,
+ * the convex obstacle corners. Two subgoals share an edge when the one is directly h-reachable from the
+ * other: an octile shortest path joins them, moving diagonally first, and no subgoal lies on it.
+ * A query links start and goal to the subgoals directly h-reachable from them and runs A* over the graph,
+ * each edge then refines into a diagonal and a cardinal segment.
+ * An edge search registers its subgoal with every block holding a cell it read, so a map change reclassifies
+ * the cells next to flipped ones and searches again only the subgoals registered with a block holding one.
+ */
+struct SubgoalGraphSearch : Grid
+{
+	// subgoal registered with a block by its edge search number scan, stale once the subgoal searched again
+	struct Reader
+	{
+		uint32_t subgoal, scan;
+	};
+
+	SubgoalGraphSearch(gppc_patch map) : Grid(map)
+		,subgoal_of(size(), uint32_t{Node::INV})
+		,shadow(map)
+		,blocks_wide((width + DIRTY_BLOCK - 1) / DIRTY_BLOCK)
+		,blocks_high((height + DIRTY_BLOCK - 1) / DIRTY_BLOCK)
+		,readers(static_cast<size_t>(blocks_wide) * blocks_high)
+		,block_seen(readers.size(), 0)
+		,block_mark(readers.size(), 0)
+	{
+		build();
+	}
+	// reads the graph from an index written by save_index, builds it if it is missing or stale
+	SubgoalGraphSearch(gppc_patch map, const char* index_file) : Grid(map)
+		,subgoal_of(size(), uint32_t{Node::INV})
+		,shadow(map)
+		,blocks_wide((width + DIRTY_BLOCK - 1) / DIRTY_BLOCK)
+		,blocks_high((height + DIRTY_BLOCK - 1) / DIRTY_BLOCK)
+		,readers(static_cast<size_t>(blocks_wide) * blocks_high)
+		,block_seen(readers.size(), 0)
+		,block_mark(readers.size(), 0)
+	{
+		if (!load_index(index_file))
+			build();
+	}
+	// writes the subgoals, their edges and the subgoals registered with each block keyed to the current map
+	bool save_index(const char* filename) const
+	{
+		std::vector<uint32_t> offsets(1, 0), targets;
+		for (const std::vector<uint32_t>& edges : out_edges) {
+			targets.insert(targets.end(), edges.begin(), edges.end());
+			offsets.push_back(static_cast<uint32_t>(targets.size()));
+		}
+		std::vector<uint32_t> block_offsets(1, 0), block_readers;
+		for (const std::vector<Reader>& block : readers) {
+			for (Reader r : block) {
+				if (r.scan == scan_of[r.subgoal])
+					block_readers.push_back(r.subgoal);
+			}
+			block_offsets.push_back(static_cast<uint32_t>(block_readers.size()));
+		}
+		return write_index(filename, SUBGOAL_INDEX_VERSION, map_key(*this), {
+			IndexSection{subgoals.data(), subgoals.size() * sizeof(uint32_t)},
+			IndexSection{offsets.data(), offsets.size() * sizeof(uint32_t)},
+			IndexSection{targets.data(), targets.size() * sizeof(uint32_t)},
+			IndexSection{block_offsets.data(), block_offsets.size() * sizeof(uint32_t)},
+			IndexSection{block_readers.data(), block_readers.size() * sizeof(uint32_t)}
+		});
+	}
+
+	// reclassifies the cells next to flipped cells and searches the edges of the new subgoals and of every
+	// subgoal registered with a dirty block
+	void update_grid(const gppc_patch* changes, uint32_t changes_length)
+	{
+		if (!shadow.diff(cells, changes, changes_length))
+			return;
+		storage.update(cells, changes, changes_length);
+		updates++;
+		dirty.clear(); pending.clear();
+		for (const std::vector<uint32_t>* flipped : {&shadow.opened, &shadow.closed})
+		for (uint32_t cell : *flipped) {
+			Point p = unpack(cell);
+			uint32_t x = static_cast<uint32_t>(p.first), y = static_cast<uint32_t>(p.second);
+			uint32_t x0 = x > 0 ? x - 1u : 0u, y0 = y > 0 ? y - 1u : 0u;
+			uint32_t x1 = std::min<uint32_t>(x + 1u, width - 1), y1 = std::min<uint32_t>(y + 1u, height - 1);
+			for (uint32_t ny = y0; ny <= y1; ++ny)
+			for (uint32_t nx = x0; nx <= x1; ++nx) {
+				uint32_t b = block_of(nx, ny);
+				if (block_mark[b] != updates) {
+					block_mark[b] = updates;
+					dirty.push_back(b);
+				}
+				classify(pack(Point(nx, ny)));
+			}
+		}
+		for (uint32_t b : dirty) {
+			// drops the stale readers while collecting the live ones
+			std::vector<Reader>& block = readers[b];
+			size_t kept = 0;
+			for (Reader r : block) {
+				if (r.scan != scan_of[r.subgoal])
+					continue;
+				block[kept++] = r;
+				enqueue(r.subgoal);
+			}
+			stale_reads -= block.size() - kept;
+			block.resize(kept);
+		}
+		for (uint32_t u : pending) {
+			if (subgoals[u] != Node::INV)
+				connect(u);
+		}
+		// removed subgoals are only referenced by subgoals searched again above
+		free_slots.insert(free_slots.end(), released.begin(), released.end());
+		released.clear();
+		if (stale_reads > live_reads)
+			compact_readers();
+	}
+
+	std::vector<gppc_point> path;
+	const std::vector<gppc_point>& get_path() const noexcept { return path; }
+	bool turning_points = false; // only return the cells where the path turns
+	// bool search found a path
+	bool search(Point s, Point g)
+	{
+		path.clear();
+		if (!get(s) || !get(g))
+			return false;
+		queries++;
+		if (s == g) {
+			// zero path case
+			path.assign({gppc_point{(uint16_t)s.first, (uint16_t)s.second},
+				gppc_point{(uint16_t)g.first, (uint16_t)g.second}});
+			return true;
+		}
+		uint32_t start = pack(s), goal = pack(g);
+		start_links.clear(); goal_links.clear();
+		scan(s, goal, start_links, [] (int, int) { });
+		scan(g, start, goal_links, [] (int, int) { });
+		uint32_t count = static_cast<uint32_t>(subgoals.size());
+		const uint32_t START = count, GOAL = count + 1;
+		if (pool.size() < count + 2u)
+			pool.resize(count + 2u);
+		pool.next_search();
+		open.clear();
+		bool direct = false;
+		for (uint32_t c : goal_links) {
+			if (c == start)
+				direct = true;
+			else
+				pool[subgoal_of[c]].to_goal = true;
+		}
+		if (subgoal_of[goal] != Node::INV)
+			pool[subgoal_of[goal]].to_goal = true;
+		pool[START].g = 0;
+		open.push(open_key(octile(s, g), 0), START);
+		auto&& cell_of = [this,START,start,goal] (uint32_t id) {
+			return id < START ? subgoals[id] : id == START ? start : goal;
+		};
+		auto&& relax = [this,&cell_of,g] (uint32_t id, uint32_t cost, uint32_t succ) {
+			SubgoalNode& S = pool[succ];
+			uint32_t succ_cost = cost + octile(unpack(cell_of(id)), unpack(cell_of(succ)));
+			if (succ_cost < S.g) {
+				S.g = succ_cost;
+				S.pred = id;
+				open.push(open_key(succ_cost + octile(unpack(cell_of(succ)), g), succ_cost), succ);
+			}
+		};
+		while (!open.empty()) {
+			uint32_t id = open.pop().second;
+			SubgoalNode& node = pool[id];
+			if (node.closed)
+				continue; // stale entry
+			if (id == GOAL) {
+				route.clear();
+				for (uint32_t at = GOAL; at != Node::NO_PRED; at = pool[at].pred)
+					route.push_back(cell_of(at));
+				refine_route();
+				return true;
+			}
+			node.closed = true;
+			expanded++;
+			uint32_t cost = node.g;
+			if (id == START) {
+				for (uint32_t c : start_links) {
+					if (c == goal)
+						direct = true;
+					else
+						relax(id, cost, subgoal_of[c]);
+				}
+				if (subgoal_of[start] != Node::INV)
+					relax(id, cost, subgoal_of[start]);
+				if (direct)
+					relax(id, cost, GOAL);
+				continue;
+			}
+			for (uint32_t v : out_edges[id])
+				relax(id, cost, v);
+			for (uint32_t v : in_edges[id])
+				relax(id, cost, v);
+			if (node.to_goal)
+				relax(id, cost, GOAL);
+		}
+		return false;
+	}
+
+	void print_stats(std::ostream& out) const
+	{
+		size_t live = 0, edges = 0;
+		for (uint32_t u = 0; u < subgoals.size(); ++u) {
+			live += subgoals[u] != Node::INV;
+			edges += out_edges[u].size();
+		}
+		out << "ssg_subgoals " << live << '\n'
+		    << "ssg_edges " << edges << '\n'
+		    << "ssg_subgoal_searches " << searched << '\n'
+		    << "ssg_block_reads " << live_reads << '\n'
+		    << "ssg_queries " << queries << '\n'
+		    << "ssg_expanded " << expanded << '\n';
+		shadow.print_stats(out);
+	}
+
+	// counters
+	size_t searched = 0; // edge searches from a subgoal, at build and in update_grid
+	size_t queries = 0;
+	size_t expanded = 0;
+
+protected:
+	bool open_cell(int x, int y) const noexcept
+	{
+		return storage.get(x, y);
+	}
+	// convex corner test
+	bool is_subgoal(int x, int y) const noexcept
+	{
+		if (!open_cell(x, y))
+			return false;
+		for (int d = 4; d < 8; ++d) {
+			int dx = SUCCESSOR_DX[d], dy = SUCCESSOR_DY[d];
+			if (!open_cell(x + dx, y + dy) && open_cell(x + dx, y) && open_cell(x, y + dy))
+				return true;
+		}
+		return false;
+	}
+	uint32_t block_of(uint32_t x, uint32_t y) const noexcept
+	{
+		return (y / DIRTY_BLOCK) * blocks_wide + x / DIRTY_BLOCK;
+	}
+
+	// walks from (x, y) by (dx, dy) for at most limit cells, appends a subgoal or target it stops on to found
+	// @return the open cells passed before the walk stopped
+	template <typename Read>
+	int walk(int x, int y, int dx, int dy, int limit, uint32_t target, std::vector<uint32_t>& found, Read&& read) const
+	{
+		for (int k = 1; k <= limit; ++k) {
+			int cx = x + k * dx, cy = y + k * dy;
+			read(cx, cy);
+			if (!open_cell(cx, cy))
+				return k - 1;
+			uint32_t c = pack(Point(cx, cy));
+			if (c == target || subgoal_of[c] != Node::INV) {
+				found.push_back(c);
+				return k - 1;
+			}
+		}
+		return limit;
+	}
+	/**
+	 * Appends the cells of the subgoals directly h-reachable from p to found, target counting as a subgoal,
+	 * and calls read(x, y) on every cell read, those outside the map included.
+	 * Cardinal walks stop on the first subgoal or blocked cell. Each diagonal walk scans the two cardinal
+	 * directions out of every cell it passes, no further than the previous scan got: anything past it is
+	 * reached as fast through the subgoal or obstacle corner that stopped that scan.
+	 */
+	template <typename Read>
+	void scan(Point p, uint32_t target, std::vector<uint32_t>& found, Read&& read) const
+	{
+		int x = p.first, y = p.second;
+		int reach[4];
+		for (int d = 0; d < 4; ++d)
+			reach[d] = walk(x, y, SUCCESSOR_DX[d], SUCCESSOR_DY[d], std::numeric_limits<int>::max(), target, found, read);
+		for (int d = 4; d < 8; ++d) {
+			int dx = SUCCESSOR_DX[d], dy = SUCCESSOR_DY[d];
+			int limit_x = reach[dx > 0 ? 1 : 3], limit_y = reach[dy > 0 ? 2 : 0];
+			for (int cx = x, cy = y; ; ) {
+				read(cx + dx, cy); read(cx, cy + dy); read(cx + dx, cy + dy);
+				if (!open_cell(cx + dx, cy) || !open_cell(cx, cy + dy) || !open_cell(cx + dx, cy + dy))
+					break;
+				cx += dx; cy += dy;
+				uint32_t c = pack(Point(cx, cy));
+				if (c == target || subgoal_of[c] != Node::INV) {
+					found.push_back(c);
+					break;
+				}
+				limit_x = walk(cx, cy, dx, 0, limit_x, target, found, read);
+				limit_y = walk(cx, cy, 0, dy, limit_y, target, found, read);
+			}
+		}
+	}
+
+	void add_subgoal(uint32_t cell)
+	{
+		uint32_t u;
+		if (!free_slots.empty()) {
+			u = free_slots.back();
+			free_slots.pop_back();
+			subgoals[u] = cell;
+		} else {
+			u = static_cast<uint32_t>(subgoals.size());
+			subgoals.push_back(cell);
+			out_edges.emplace_back();
+			in_edges.emplace_back();
+			scan_of.push_back(0);
+			read_count.push_back(0);
+			queued.push_back(0);
+		}
+		subgoal_of[cell] = u;
+	}
+	void drop_edges(uint32_t u)
+	{
+		for (uint32_t v : out_edges[u]) {
+			std::vector<uint32_t>& back = in_edges[v];
+			auto it = std::find(back.begin(), back.end(), u);
+			assert(it != back.end());
+			*it = back.back();
+			back.pop_back();
+		}
+		out_edges[u].clear();
+	}
+	// adds or removes the subgoal at cell as the map now says
+	void classify(uint32_t cell)
+	{
+		Point p = unpack(cell);
+		bool want = is_subgoal(p.first, p.second);
+		uint32_t u = subgoal_of[cell];
+		if (want && u == Node::INV) {
+			add_subgoal(cell);
+			enqueue(subgoal_of[cell]);
+		} else if (!want && u != Node::INV) {
+			drop_edges(u);
+			retire_reads(u);
+			subgoals[u] = Node::INV;
+			subgoal_of[cell] = Node::INV;
+			released.push_back(u);
+		}
+	}
+	// queues subgoal u to be searched again by the current update
+	void enqueue(uint32_t u)
+	{
+		if (queued[u] != updates) {
+			queued[u] = updates;
+			pending.push_back(u);
+		}
+	}
+	// makes the readers registered by the last edge search of subgoal u stale
+	void retire_reads(uint32_t u)
+	{
+		scan_of[u]++;
+		stale_reads += read_count[u];
+		live_reads -= read_count[u];
+		read_count[u] = 0;
+	}
+	// drops every stale reader
+	void compact_readers()
+	{
+		for (std::vector<Reader>& block : readers) {
+			block.erase(std::remove_if(block.begin(), block.end(), [this] (Reader r) { return r.scan != scan_of[r.subgoal]; }),
+				block.end());
+		}
+		stale_reads = 0;
+	}
+	// replaces the edges found from subgoal u and the blocks it is registered with
+	void connect(uint32_t u)
+	{
+		drop_edges(u);
+		retire_reads(u);
+		found.clear();
+		searched++;
+		scan(unpack(subgoals[u]), Node::INV, found, [this,u] (int x, int y) {
+			if (x < 0 || y < 0 || x >= static_cast<int>(width) || y >= static_cast<int>(height))
+				return; // never changes
+			uint32_t b = block_of(static_cast<uint32_t>(x), static_cast<uint32_t>(y));
+			if (block_seen[b] == searched)
+				return;
+			block_seen[b] = searched;
+			readers[b].push_back(Reader{u, scan_of[u]});
+			read_count[u]++;
+			live_reads++;
+		});
+		for (uint32_t c : found) {
+			uint32_t v = subgoal_of[c];
+			out_edges[u].push_back(v);
+			in_edges[v].push_back(u);
+		}
+	}
+	void build()
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		for (uint32_t x = 0; x < width; ++x) {
+			if (is_subgoal(static_cast<int>(x), static_cast<int>(y)))
+				add_subgoal(pack(Point(x, y)));
+		}
+		for (uint32_t u = 0; u < subgoals.size(); ++u)
+			connect(u);
+	}
+	bool load_index(const char* filename)
+	{
+		FileMapping mapping;
+		std::vector<IndexSection> sections;
+		if (!map_index(mapping, filename, SUBGOAL_INDEX_VERSION, map_key(*this), sections))
+			return false;
+		if (sections.size() != 5)
+			return false;
+		size_t count = sections[0].bytes / sizeof(uint32_t);
+		if (sections[1].bytes != (count + 1) * sizeof(uint32_t) || sections[3].bytes != (readers.size() + 1) * sizeof(uint32_t))
+			return false;
+		const uint32_t* cell = static_cast<const uint32_t*>(sections[0].data);
+		const uint32_t* offsets = static_cast<const uint32_t*>(sections[1].data);
+		const uint32_t* targets = static_cast<const uint32_t*>(sections[2].data);
+		const uint32_t* block_offsets = static_cast<const uint32_t*>(sections[3].data);
+		const uint32_t* block_readers = static_cast<const uint32_t*>(sections[4].data);
+		if (offsets[count] * sizeof(uint32_t) != sections[2].bytes || block_offsets[readers.size()] * sizeof(uint32_t) != sections[4].bytes)
+			return false;
+		subgoals.assign(cell, cell + count);
+		out_edges.assign(count, {});
+		in_edges.assign(count, {});
+		scan_of.assign(count, 0);
+		read_count.assign(count, 0);
+		queued.assign(count, 0);
+		for (uint32_t u = 0; u < count; ++u) {
+			if (subgoals[u] == Node::INV) {
+				free_slots.push_back(u);
+				continue;
+			}
+			subgoal_of[subgoals[u]] = u;
+			out_edges[u].assign(targets + offsets[u], targets + offsets[u + 1]);
+			for (uint32_t v : out_edges[u])
+				in_edges[v].push_back(u);
+		}
+		for (uint32_t b = 0; b < readers.size(); ++b) {
+			for (uint32_t i = block_offsets[b]; i < block_offsets[b + 1]; ++i) {
+				readers[b].push_back(Reader{block_readers[i], 0});
+				read_count[block_readers[i]]++;
+			}
+		}
+		live_reads = block_offsets[readers.size()];
+		return true;
+	}
+
+	// moves one cell at a time from at to to along a straight or diagonal line
+	void walk_path(Point& at, Point to)
+	{
+		auto&& sign = [] (int d) { return (d > 0) - (d < 0); };
+		int dx = sign(to.first - at.first), dy = sign(to.second - at.second);
+		while (at != to) {
+			at.first += dx; at.second += dy;
+			push_path_point(path, at, turning_points);
+		}
+	}
+	// a straight or diagonal line from a to b is traversable
+	bool clear_line(Point a, Point b) const noexcept
+	{
+		auto&& sign = [] (int d) { return (d > 0) - (d < 0); };
+		int dx = sign(b.first - a.first), dy = sign(b.second - a.second);
+		for (; a != b; a.first += dx, a.second += dy) {
+			if (!open_cell(a.first + dx, a.second) || !open_cell(a.first, a.second + dy) || !open_cell(a.first + dx, a.second + dy))
+				return false;
+		}
+		return true;
+	}
+	// route holds the cells goal to start, every step h-reachable diagonal first from one of its ends
+	void refine_route()
+	{
+		Point at = unpack(route.back());
+		push_path_point(path, at, turning_points);
+		for (size_t i = route.size() - 1; i-- > 0; ) {
+			Point to = unpack(route[i]);
+			int dx = to.first - at.first, dy = to.second - at.second;
+			int n = std::min(std::abs(dx), std::abs(dy));
+			int sx = (dx > 0) - (dx < 0), sy = (dy > 0) - (dy < 0);
+			Point bend(at.first + n * sx, at.second + n * sy);
+			if (!clear_line(at, bend) || !clear_line(bend, to))
+				bend = Point(to.first - n * sx, to.second - n * sy); // cardinal first
+			walk_path(at, bend);
+			walk_path(at, to);
+		}
+	}
+
+	std::vector<uint32_t> subgoals; // cell of each subgoal, Node::INV for a free slot
+	std::vector<std::vector<uint32_t>> out_edges; // subgoals found by the edge search of each subgoal
+	std::vector<std::vector<uint32_t>> in_edges; // subgoals whose edge search found each subgoal
+	std::vector<uint32_t> subgoal_of; // per cell, Node::INV if not a subgoal
+	std::vector<uint32_t> free_slots;
+	std::vector<uint32_t> released; // slots freed by the current update
+	ShadowMap shadow; // map as of the last change
+	uint32_t blocks_wide;
+	uint32_t blocks_high;
+	std::vector<std::vector<Reader>> readers; // per block, the subgoals whose edge search read a cell of it
+	std::vector<uint32_t> scan_of; // per subgoal, number of its last edge search
+	std::vector<uint32_t> read_count; // per subgoal, blocks its last edge search registered with
+	size_t live_reads = 0, stale_reads = 0;
+	std::vector<size_t> block_seen; // per block, value of searched when last registered with
+	// update scratch
+	uint32_t updates = 0;
+	std::vector<uint32_t> block_mark; // per block, value of updates when last dirty
+	std::vector<uint32_t> dirty; // blocks within a cell of a flipped cell
+	std::vector<uint32_t> queued; // per subgoal, value of updates when last queued
+	std::vector<uint32_t> pending; // subgoals to search again
+	// query scratch
+	std::vector<uint32_t> found;
+	std::vector<uint32_t> start_links, goal_links;
+	std::vector<uint32_t> route;
+	NodePool<SubgoalNode> pool;
+	OpenList open;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef OPT_GPPC_THREAD_POOL_HXX
+#define OPT_GPPC_THREAD_POOL_HXX
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+namespace baseline
+{
+
+/**
+ * Fixed set of worker threads running batches of indexed tasks.
+ * run(count, fn) calls fn(task, worker) for every task < count and returns once all finished,
+ * the calling thread joins in as worker 0. Tasks are handed out in index order.
+ */
+class ThreadPool
+{
+public:
+	// threads counts the caller, a pool of 1 runs everything inline
+	explicit ThreadPool(unsigned threads)
+	{
+		for (unsigned i = 1; i < threads; ++i)
+			workers.emplace_back([this,i] { work(i); });
+	}
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_all();
+		for (std::thread& t : workers)
+			t.join();
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned size() const noexcept { return static_cast<unsigned>(workers.size()) + 1; }
+
+	template <typename Fn>
+	void run(size_t count, Fn&& fn)
+	{
+		if (workers.empty() || count < 2) {
+			for (size_t i = 0; i < count; ++i)
+				fn(i, 0u);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = std::ref(fn);
+			job_count = count;
+			next = 0;
+			busy = static_cast<unsigned>(workers.size());
+			epoch++;
+		}
+		wake.notify_all();
+		drain(0);
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy == 0; });
+		job = nullptr;
+	}
+
+private:
+	void drain(unsigned worker)
+	{
+		for (size_t i; (i = next.fetch_add(1)) < job_count; )
+			job(i, worker);
+	}
+	void work(unsigned worker)
+	{
+		uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this,seen] { return stop || epoch != seen; });
+				if (stop)
+					return;
+				seen = epoch;
+			}
+			drain(worker);
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	std::function<void(size_t, unsigned)> job;
+	size_t job_count = 0;
+	std::atomic<size_t> next{0};
+	unsigned busy = 0;
+	uint64_t epoch = 0;
+	bool stop = false;
+};
+
+} // namespace baseline
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef OPT_GPPC_BENCH_SCENARIO_HXX
+#define OPT_GPPC_BENCH_SCENARIO_HXX
+
+// Scaffolding shared by the benches that replay a scenario, map changes included, through engines.
+
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include "ScenarioLoader.h"
+#include "Timer.h"
+#include "BaselineSearch.hxx"
+#include "SearchPool.hxx"
+
+namespace bench
+{
+
+// octile cost of a path of cells
+inline uint64_t path_cost(const std::vector<gppc_point>& path)
+{
+	uint64_t cost = 0;
+	for (size_t i = 1; i < path.size(); ++i)
+		cost += baseline::octile(baseline::Point(path[i-1].x, path[i-1].y), baseline::Point(path[i].x, path[i].y));
+	return cost;
+}
+
+// loads the scenario given as argv[1] and prints its map size, false after printing why it could not
+inline bool load_scenario(int argc, char** argv, GPPC::ScenarioLoader& scen)
+{
+	if (argc < 2) {
+		std::printf("Usage %s <scenario>\n", argv[0]);
+		return false;
+	}
+	if (!scen.load(argv[1])) {
+		std::fprintf(stderr, "Failed to load scenario file: %s\n", argv[1]);
+		return false;
+	}
+	std::printf("%s %dx%d\n", argv[1], scen.getWidth(), scen.getHeight());
+	return true;
+}
+
+// wall time of fn() in ms
+template <typename Fn>
+double time_ms(Fn&& fn)
+{
+	GPPC::Timer timer;
+	timer.StartTimer();
+	fn();
+	timer.EndTimer();
+	return timer.GetElapsedTime().count() * 1e-6;
+}
+
+// total and slowest of repeated timings
+struct Times
+{
+	double total = 0, slowest = 0;
+	size_t calls = 0;
+	void add(double ms)
+	{
+		total += ms;
+		slowest = std::max(slowest, ms);
+		calls++;
+	}
+	void print(const char* name) const
+	{
+		std::printf("%-8s %6zu calls  total %10.3f ms  mean %8.4f ms  slowest %8.3f ms\n",
+			name, calls, total, calls != 0 ? total / calls : 0.0, slowest);
+	}
+};
+
+/**
+ * Steps through the queries of a scenario in order.
+ * map() is the map of the first query, to build engines from, run() then calls on_change(changes, changes_length)
+ * whenever the map changes before a query and on_query(start, goal) for every query.
+ */
+struct ScenarioSteps
+{
+	explicit ScenarioSteps(const GPPC::ScenarioLoader& scen)
+	{
+		runner.linkScen(scen);
+		runner.nextQuery();
+	}
+	gppc_patch map() const noexcept { return runner.getActiveMap(); }
+
+	template <typename OnChange, typename OnQuery>
+	void run(OnChange&& on_change, OnQuery&& on_query)
+	{
+		for (int changes = 0; changes >= 0; changes = runner.nextQuery()) {
+			if (changes > 0) {
+				const auto& patches = runner.getAppliedPatches();
+				on_change(patches.data(), static_cast<uint32_t>(patches.size()));
+			}
+			auto q = runner.getCurrentQuery();
+			on_query(baseline::Point(q.start.x, q.start.y), baseline::Point(q.goal.x, q.goal.y));
+		}
+	}
+
+	GPPC::ScenarioRunner runner;
+};
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,66 @@
+// Runs BidirectionalSearch and AStarSearch through a scenario, map changes included, and compares the
+// nodes they expand and their time: over all queries, over the long ones (start and goal at least a
+// quarter of the map's larger side apart) and over those without a path.
+// Path costs are checked against A*.
+
+#include <cstdio>
+#include <algorithm>
+#include "BenchScenario.hxx"
+#include "AStarSearch.hxx"
+#include "BidirectionalSearch.hxx"
+
+namespace {
+
+struct Tally
+{
+	size_t queries = 0;
+	uint64_t expanded[2] = {0, 0}; // A*, bidirectional
+	double ms[2] = {0, 0};
+	void add(size_t astar_expanded, size_t bidir_expanded, double astar_ms, double bidir_ms)
+	{
+		queries++;
+		expanded[0] += astar_expanded; expanded[1] += bidir_expanded;
+		ms[0] += astar_ms; ms[1] += bidir_ms;
+	}
+	void print(const char* name) const
+	{
+		std::printf("%-7s %5zu queries  expanded astar %11llu bidir %11llu (%.3f)  ms astar %10.3f bidir %10.3f\n",
+			name, queries, static_cast<unsigned long long>(expanded[0]), static_cast<unsigned long long>(expanded[1]),
+			expanded[0] != 0 ? static_cast<double>(expanded[1]) / expanded[0] : 0.0, ms[0], ms[1]);
+	}
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	GPPC::ScenarioLoader scen;
+	if (!bench::load_scenario(argc, argv, scen))
+		return 1;
+	bench::ScenarioSteps steps(scen);
+	baseline::AStarSearch astar(steps.map());
+	baseline::BidirectionalSearch bidir(steps.map());
+	uint32_t long_query = baseline::COST_0 * static_cast<uint32_t>(std::max(scen.getWidth(), scen.getHeight())) / 4;
+	Tally all, longer, missing;
+	size_t mismatches = 0;
+	steps.run([&] (const gppc_patch* changes, uint32_t changes_length) {
+		astar.update_grid(changes, changes_length);
+		bidir.update_grid(changes, changes_length);
+	}, [&] (baseline::Point s, baseline::Point g) {
+		bool found = false, astar_found = false;
+		double astar_ms = bench::time_ms([&] { astar_found = astar.search(s, g); });
+		double bidir_ms = bench::time_ms([&] { found = bidir.search(s, g); });
+		if (found != astar_found || bench::path_cost(bidir.get_path()) != bench::path_cost(astar.get_path()))
+			mismatches++;
+		all.add(astar.expanded, bidir.expanded, astar_ms, bidir_ms);
+		if (baseline::octile(s, g) >= long_query)
+			longer.add(astar.expanded, bidir.expanded, astar_ms, bidir_ms);
+		if (!astar_found)
+			missing.add(astar.expanded, bidir.expanded, astar_ms, bidir_ms);
+	});
+	all.print("all");
+	longer.print("long");
+	missing.print("no-path");
+	std::printf("%zu path costs differ from A*\n", mismatches);
+	return mismatches != 0;
+}
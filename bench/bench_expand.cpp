@@ -0,0 +1,124 @@
+// Compares the neighbourhood kernels of dijkstra by expansions per second.
+// checked: the per-direction branch chain over nine bounds checked Grid::get calls that for_each_successor used to be.
+// table: for_each_successor, the block3 mask of the Grid storage indexing SUCCESSOR_TABLE.
+// Each kernel grows a dijkstra tree from every unreached open cell of the scenario map, and of a
+// synthetic open GPPC_HARD_MAP_LIMIT square map, and the trees are compared by a cost checksum.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "GPPC.h"
+#include "ScenarioLoader.h"
+#include "Timer.h"
+#include "BaselineSearch.hxx"
+
+namespace {
+
+struct Result
+{
+	double ms;
+	uint64_t expansions;
+	uint64_t checksum;
+};
+
+// the previous for_each_successor
+struct CheckedKernel
+{
+	template <typename Fn>
+	void operator()(const baseline::Grid& grid, uint32_t node, Fn&& fn) const
+	{
+		using baseline::Compass;
+		baseline::Point p = grid.unpack(node);
+		uint32_t mask = 0;
+		for (int i = 0, dy = -1; dy < 2; dy++)
+		for (int dx = -1; dx < 2; dx++)
+			mask |= static_cast<uint32_t>(grid.get(baseline::Point(p.first + dx, p.second + dy))) << i++;
+		mask = ~mask;
+		uint32_t w = grid.width;
+		if ((mask & static_cast<uint32_t>(Compass::N)) == 0) fn(node - w, baseline::COST_0);
+		if ((mask & static_cast<uint32_t>(Compass::E)) == 0) fn(node + 1, baseline::COST_0);
+		if ((mask & static_cast<uint32_t>(Compass::S)) == 0) fn(node + w, baseline::COST_0);
+		if ((mask & static_cast<uint32_t>(Compass::W)) == 0) fn(node - 1, baseline::COST_0);
+		if ((mask & static_cast<uint32_t>(Compass::NE)) == 0) fn(node - w + 1, baseline::COST_1);
+		if ((mask & static_cast<uint32_t>(Compass::NW)) == 0) fn(node - w - 1, baseline::COST_1);
+		if ((mask & static_cast<uint32_t>(Compass::SE)) == 0) fn(node + w + 1, baseline::COST_1);
+		if ((mask & static_cast<uint32_t>(Compass::SW)) == 0) fn(node + w - 1, baseline::COST_1);
+	}
+};
+struct TableKernel
+{
+	template <typename Fn>
+	void operator()(const baseline::Grid& grid, uint32_t node, Fn&& fn) const
+	{
+		baseline::for_each_successor(grid, node, fn);
+	}
+};
+
+template <typename Kernel>
+Result run(baseline::Grid& grid, Kernel kernel)
+{
+	using baseline::Node;
+	Result res{};
+	GPPC::Timer timer;
+	grid.nodes.assign(grid.size(), Node{Node::INV, Node::INV});
+	baseline::DijkstraQueue Q;
+	timer.StartTimer();
+	for (uint32_t origin = 0; origin < grid.size(); ++origin) {
+		if (!grid.get_unbound(origin) || grid.nodes[origin].cost != Node::INV)
+			continue;
+		grid.nodes[origin] = Node{Node::NO_PRED, 0};
+		Q.emplace(0, origin);
+		while (!Q.empty()) {
+			auto top = Q.top(); Q.pop();
+			uint32_t cost = top.first, node = top.second;
+			if (cost != grid.nodes[node].cost)
+				continue;
+			res.expansions++;
+			kernel(grid, node, [&grid,&Q,node,cost] (uint32_t succ, uint32_t edge_cost) {
+				Node& N = grid.nodes[succ];
+				if (cost + edge_cost < N.cost) {
+					N.pred = node;
+					N.cost = cost + edge_cost;
+					Q.emplace(cost + edge_cost, succ);
+				}
+			});
+		}
+	}
+	timer.EndTimer();
+	res.ms = timer.GetElapsedTime().count() * 1e-6;
+	for (const Node& n : grid.nodes)
+		res.checksum = res.checksum * 31 + n.cost;
+	return res;
+}
+
+void compare(const char* name, gppc_patch map)
+{
+	baseline::Grid grid(map);
+	Result a = run(grid, CheckedKernel{}), b = run(grid, TableKernel{});
+	std::printf("%-24s %5ux%-5u %10llu expansions  checked %7.2f M/s  table %7.2f M/s  %s\n",
+		name, map.width, map.height, static_cast<unsigned long long>(a.expansions),
+		a.expansions / (a.ms * 1e3), b.expansions / (b.ms * 1e3),
+		a.checksum == b.checksum && a.expansions == b.expansions ? "same" : "MISMATCH");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const uint32_t side = static_cast<uint32_t>(GPPC::GPPC_HARD_MAP_LIMIT);
+	std::vector<uint8_t> open((static_cast<size_t>(side) * side + 7) / 8, 0xFF);
+	compare("synthetic open", gppc_patch{open.data(), static_cast<uint16_t>(side), static_cast<uint16_t>(side), gppc_point{0, 0}});
+	if (argc > 1) {
+		GPPC::ScenarioLoader scen;
+		if (!scen.load(argv[1])) {
+			std::fprintf(stderr, "Failed to load scenario file: %s\n", argv[1]);
+			return 1;
+		}
+		GPPC::ScenarioRunner runner;
+		runner.linkScen(scen);
+		runner.nextQuery();
+		compare(argv[1], runner.getActiveMap());
+	}
+	return 0;
+}
@@ -0,0 +1,144 @@
+// Compares the std::stack flood fill that flood_fill used to be with the word parallel BitFlood.
+// Both label every component of synthetic GPPC_HARD_MAP_LIMIT square maps, fully open and with random
+// obstacles, and of the scenario map when given. Components are compared by (min cell, size, cell sum).
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <stack>
+#include <random>
+#include <algorithm>
+#include "GPPC.h"
+#include "ScenarioLoader.h"
+#include "Timer.h"
+#include "BitFlood.hxx"
+
+namespace {
+
+struct Component
+{
+	uint64_t first;
+	uint64_t size;
+	uint64_t sum;
+	bool operator==(const Component& o) const noexcept { return first == o.first && size == o.size && sum == o.sum; }
+	bool operator<(const Component& o) const noexcept { return first < o.first; }
+};
+
+struct Result
+{
+	double ms;
+	std::vector<Component> components;
+};
+
+// the previous flood_fill: a stack of points, four bounds checked neighbours per cell
+Result stack_flood(gppc_patch map)
+{
+	Result res{};
+	GPPC::Timer timer;
+	timer.StartTimer();
+	uint32_t width = map.width, height = map.height;
+	std::vector<bool> seen(static_cast<size_t>(width) * height);
+	std::stack<std::pair<int,int>, std::vector<std::pair<int,int>>> Q;
+	auto&& push = [&] (int x, int y) {
+		if (static_cast<uint32_t>(x) < width && static_cast<uint32_t>(y) < height) {
+			size_t id = static_cast<size_t>(y) * width + x;
+			if (!seen[id] && gppc_patch_get(map, static_cast<int>(id))) {
+				seen[id] = true;
+				Q.push({x, y});
+			}
+		}
+	};
+	for (size_t i = 0; i < seen.size(); ++i) {
+		if (seen[i] || !gppc_patch_get(map, static_cast<int>(i)))
+			continue;
+		Component c{i, 0, 0};
+		push(static_cast<int>(i % width), static_cast<int>(i / width));
+		while (!Q.empty()) {
+			auto p = Q.top(); Q.pop();
+			size_t id = static_cast<size_t>(p.second) * width + p.first;
+			c.first = std::min<uint64_t>(c.first, id);
+			c.size++;
+			c.sum += id;
+			push(p.first + 1, p.second);
+			push(p.first - 1, p.second);
+			push(p.first, p.second + 1);
+			push(p.first, p.second - 1);
+		}
+		res.components.push_back(c);
+	}
+	timer.EndTimer();
+	res.ms = timer.GetElapsedTime().count() * 1e-6;
+	return res;
+}
+
+Result bit_flood(gppc_patch map)
+{
+	Result res{};
+	GPPC::Timer timer;
+	timer.StartTimer();
+	baseline::BitFlood flood;
+	flood.load(map);
+	uint32_t width = map.width;
+	for (uint32_t x, y; flood.next(x, y); ) {
+		Component c{static_cast<uint64_t>(y) * width + x, 0, 0};
+		flood.fill(x, y, [&c,width] (uint32_t mx, uint32_t my) {
+			uint64_t id = static_cast<uint64_t>(my) * width + mx;
+			c.first = std::min(c.first, id);
+			c.size++;
+			c.sum += id;
+		});
+		res.components.push_back(c);
+	}
+	timer.EndTimer();
+	res.ms = timer.GetElapsedTime().count() * 1e-6;
+	return res;
+}
+
+void compare(const char* name, gppc_patch map)
+{
+	Result a = stack_flood(map), b = bit_flood(map);
+	std::sort(a.components.begin(), a.components.end());
+	std::sort(b.components.begin(), b.components.end());
+	std::printf("%-24s %5ux%-5u %8zu components  stack %9.3f ms  bitflood %9.3f ms  %s\n",
+		name, map.width, map.height, a.components.size(), a.ms, b.ms,
+		a.components == b.components ? "same" : "MISMATCH");
+}
+
+// width x height map, each cell blocked with probability blocked
+std::vector<uint8_t> synthetic(uint32_t width, uint32_t height, double blocked, unsigned seed)
+{
+	size_t cells = static_cast<size_t>(width) * height;
+	std::vector<uint8_t> bits((cells + 7) / 8, 0);
+	std::mt19937 rng(seed);
+	std::bernoulli_distribution open(1.0 - blocked);
+	for (size_t i = 0; i < cells; ++i) {
+		if (blocked == 0 || open(rng))
+			bits[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+	}
+	return bits;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const uint32_t side = static_cast<uint32_t>(GPPC::GPPC_HARD_MAP_LIMIT);
+	for (double blocked : {0.0, 0.4}) {
+		std::vector<uint8_t> bits = synthetic(side, side, blocked, 1);
+		gppc_patch map{bits.data(), static_cast<uint16_t>(side), static_cast<uint16_t>(side), gppc_point{0, 0}};
+		compare(blocked == 0 ? "synthetic open" : "synthetic 40% blocked", map);
+	}
+	if (argc > 1) {
+		GPPC::ScenarioLoader scen;
+		if (!scen.load(argv[1])) {
+			std::fprintf(stderr, "Failed to load scenario file: %s\n", argv[1]);
+			return 1;
+		}
+		GPPC::ScenarioRunner runner;
+		runner.linkScen(scen);
+		runner.nextQuery();
+		compare(argv[1], runner.getActiveMap());
+	}
+	return 0;
+}
@@ -0,0 +1,64 @@
+// Compares the heuristics of BasicAStarSearch on a scenario, octile against differential heuristics
+// over a few landmark counts, the map changed between queries as the scenario says.
+// build: the landmark distances of the starting map. update: update_grid of every map change, total.
+// astar: every query, with the nodes expanded. Path costs are checked against the octile run.
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "BenchScenario.hxx"
+#include "AStarSearch.hxx"
+
+namespace {
+
+struct Result
+{
+	double build_ms;
+	double update_ms;
+	double astar_ms;
+	uint64_t expanded;
+	std::vector<uint64_t> costs;
+};
+
+template <typename Heuristic>
+Result run(const GPPC::ScenarioLoader& scen)
+{
+	using Search = baseline::BasicAStarSearch<baseline::Grid::cells_type, baseline::RowMajorIds, Heuristic>;
+	Result res{};
+	bench::ScenarioSteps steps(scen);
+	std::unique_ptr<Search> astar;
+	res.build_ms = bench::time_ms([&] { astar.reset(new Search(steps.map())); });
+	steps.run([&] (const gppc_patch* changes, uint32_t changes_length) {
+		res.update_ms += bench::time_ms([&] { astar->update_grid(changes, changes_length); });
+	}, [&] (baseline::Point s, baseline::Point g) {
+		res.astar_ms += bench::time_ms([&] { astar->search(s, g); });
+		res.expanded += astar->expanded;
+		res.costs.push_back(bench::path_cost(astar->get_path()));
+	});
+	return res;
+}
+
+void print(const char* name, const Result& res, const Result& ref)
+{
+	size_t differ = 0;
+	for (size_t i = 0; i < res.costs.size(); ++i)
+		differ += res.costs[i] != ref.costs[i];
+	std::printf("%-8s build %9.3f ms  update %9.3f ms  astar %10.3f ms  expanded %11llu (%.3f)  %s\n",
+		name, res.build_ms, res.update_ms, res.astar_ms, static_cast<unsigned long long>(res.expanded),
+		static_cast<double>(res.expanded) / ref.expanded, differ == 0 ? "same" : "MISMATCH");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	GPPC::ScenarioLoader scen;
+	if (!bench::load_scenario(argc, argv, scen))
+		return 1;
+	Result ref = run<baseline::OctileHeuristic>(scen);
+	print("octile", ref, ref);
+	print("dh4", run<baseline::DifferentialHeuristic<4>>(scen), ref);
+	print("dh8", run<baseline::DifferentialHeuristic<8>>(scen), ref);
+	print("dh16", run<baseline::DifferentialHeuristic<16>>(scen), ref);
+	return 0;
+}
@@ -0,0 +1,237 @@
+// Compares the node id layouts of BasicGrid on a scenario map, with the cell storage Grid picks.
+// dijkstra: a tree from every unreached open cell of the starting map, in expansions per second.
+// astar: every query of the scenario with BasicAStarSearch, the map changed between them as the scenario says.
+// misses: the node array addresses a dijkstra pass reads, replayed through models of a 32 KiB 8-way L1,
+// a 1 MiB 16-way L2 and a 64 entry 4-way TLB of 4 KiB pages, all LRU. Where the kernel offers hardware
+// counters, the cache misses of the timed runs are printed as well.
+// Results are checked against the RowMajorIds run by a cost checksum and the summed path lengths.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "ScenarioLoader.h"
+#include "Timer.h"
+#include "BaselineSearch.hxx"
+#include "AStarSearch.hxx"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// set associative LRU cache over 2^line_shift byte lines, counts the misses of the addresses shown to it
+struct CacheModel
+{
+	CacheModel(uint32_t sets, uint32_t ways, uint32_t line_shift)
+		: sets(sets), ways(ways), line_shift(line_shift), tags(static_cast<size_t>(sets) * ways, ~uint64_t{0})
+	{ }
+	void touch(uint64_t address)
+	{
+		uint64_t line = address >> line_shift;
+		uint64_t* set = &tags[(line % sets) * ways];
+		uint32_t i = 0;
+		while (i < ways && set[i] != line)
+			++i;
+		if (i == ways) {
+			misses++;
+			i = ways - 1;
+		}
+		// most recently used first
+		for (; i > 0; --i)
+			set[i] = set[i-1];
+		set[0] = line;
+	}
+
+	uint32_t sets, ways, line_shift;
+	std::vector<uint64_t> tags;
+	uint64_t misses = 0;
+};
+
+// DijkstraQueue showing the node reads of dijkstra_relax to the cache models
+template <typename GridT>
+struct ModelQueue
+{
+	bool empty() const { return Q.empty(); }
+	std::pair<uint32_t, uint32_t> top() { return Q.top(); }
+	void emplace(uint32_t cost, uint32_t id) { Q.emplace(cost, id); }
+	void pop()
+	{
+		auto v = Q.top();
+		Q.pop();
+		touch(v.second);
+		if (v.first == grid.nodes[v.second].cost)
+			baseline::for_each_successor(grid, v.second, [this] (uint32_t succ, uint32_t) { touch(succ); });
+	}
+	void touch(uint32_t id)
+	{
+		uint64_t address = static_cast<uint64_t>(id) * sizeof(baseline::Node);
+		for (CacheModel* m : models)
+			m->touch(address);
+	}
+
+	const GridT& grid;
+	std::vector<CacheModel*> models;
+	baseline::DijkstraQueue Q;
+};
+
+// hardware cache misses of the calling thread between start and stop, -1 if no counter is available
+struct MissCounter
+{
+	MissCounter()
+	{
+#ifdef __linux__
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+	~MissCounter()
+	{
+#ifdef __linux__
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+	void start()
+	{
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	long long stop()
+	{
+		long long count = -1;
+#ifdef __linux__
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count))
+				count = -1;
+		}
+#endif
+		return count;
+	}
+
+	int fd = -1;
+};
+
+struct Result
+{
+	double dijkstra_ms;
+	uint64_t expansions;
+	uint64_t checksum;
+	long long dijkstra_hw_misses;
+	uint64_t l1_misses, l2_misses, tlb_misses;
+	double astar_ms;
+	long long astar_hw_misses;
+	uint64_t path_cells;
+};
+
+template <typename GridT, typename Queue>
+void dijkstra_all(GridT& grid, Queue& Q)
+{
+	using baseline::Node;
+	grid.nodes.assign(grid.size(), Node{Node::INV, Node::INV});
+	for (uint32_t y = 0; y < grid.height; ++y)
+	for (uint32_t x = 0; x < grid.width; ++x) {
+		uint32_t origin = grid.pack(baseline::Point(x, y));
+		if (grid.get_unbound(origin) && grid.nodes[origin].cost == Node::INV)
+			baseline::dijkstra(grid, Q, origin);
+	}
+}
+
+template <typename Ids>
+Result run(const GPPC::ScenarioLoader& scen)
+{
+	using baseline::Node;
+	using GridT = baseline::BasicGrid<baseline::Grid::cells_type, Ids>;
+	Result res{};
+	GPPC::Timer timer;
+	MissCounter counter;
+	GPPC::ScenarioRunner runner;
+	runner.linkScen(scen);
+	runner.nextQuery();
+	{
+		GridT grid(runner.getActiveMap());
+		baseline::DijkstraQueue Q;
+		counter.start();
+		timer.StartTimer();
+		dijkstra_all(grid, Q);
+		timer.EndTimer();
+		res.dijkstra_hw_misses = counter.stop();
+		res.dijkstra_ms = timer.GetElapsedTime().count() * 1e-6;
+		for (uint32_t y = 0; y < grid.height; ++y)
+		for (uint32_t x = 0; x < grid.width; ++x) {
+			const Node& n = grid.nodes[grid.pack(baseline::Point(x, y))];
+			res.checksum = res.checksum * 31 + n.cost;
+			res.expansions += n.cost != Node::INV;
+		}
+		CacheModel l1(64, 8, 6), l2(1024, 16, 6), tlb(16, 4, 12);
+		ModelQueue<GridT> model{grid, {&l1, &l2, &tlb}, {}};
+		dijkstra_all(grid, model);
+		res.l1_misses = l1.misses;
+		res.l2_misses = l2.misses;
+		res.tlb_misses = tlb.misses;
+	}
+	baseline::BasicAStarSearch<baseline::Grid::cells_type, Ids> astar(runner.getActiveMap());
+	counter.start();
+	for (int changes = 0; changes >= 0; changes = runner.nextQuery()) {
+		if (changes > 0) {
+			const auto& patches = runner.getAppliedPatches();
+			astar.update_grid(patches.data(), static_cast<uint32_t>(patches.size()));
+		}
+		auto q = runner.getCurrentQuery();
+		timer.StartTimer();
+		astar.search(baseline::Point(q.start.x, q.start.y), baseline::Point(q.goal.x, q.goal.y));
+		timer.EndTimer();
+		res.astar_ms += timer.GetElapsedTime().count() * 1e-6;
+		res.path_cells += astar.get_path().size();
+	}
+	res.astar_hw_misses = counter.stop();
+	return res;
+}
+
+void print(const char* name, const Result& res, const Result& ref)
+{
+	std::printf("%-4s dijkstra %7.2f M/s  astar %9.3f ms  model misses/expansion l1 %.3f l2 %.3f tlb %.3f  %s\n",
+		name, res.expansions / (res.dijkstra_ms * 1e3), res.astar_ms,
+		static_cast<double>(res.l1_misses) / res.expansions, static_cast<double>(res.l2_misses) / res.expansions,
+		static_cast<double>(res.tlb_misses) / res.expansions,
+		res.checksum == ref.checksum && res.path_cells == ref.path_cells ? "same" : "MISMATCH");
+	if (res.dijkstra_hw_misses >= 0)
+		std::printf("     hardware cache misses dijkstra %lld astar %lld\n", res.dijkstra_hw_misses, res.astar_hw_misses);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::printf("Usage %s <scenario>\n", argv[0]);
+		return 1;
+	}
+	GPPC::ScenarioLoader scen;
+	if (!scen.load(argv[1])) {
+		std::fprintf(stderr, "Failed to load scenario file: %s\n", argv[1]);
+		return 1;
+	}
+	std::printf("%s %dx%d\n", argv[1], scen.getWidth(), scen.getHeight());
+	Result ref = run<baseline::RowMajorIds>(scen);
+	print("row", ref, ref);
+	print("tile", run<baseline::TiledIds>(scen), ref);
+	if (ref.dijkstra_hw_misses < 0)
+		std::printf("no hardware cache miss counter available\n");
+	return 0;
+}
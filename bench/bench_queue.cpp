@@ -0,0 +1,90 @@
+// Compares the dijkstra queues of setup_grid on a scenario map.
+// init: setup_grid on the starting map, rebuild: full setup_grid after every map change of the scenario.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "ScenarioLoader.h"
+#include "Timer.h"
+#include "BaselineSearch.hxx"
+
+namespace {
+
+struct Result
+{
+	double init_ms;
+	double rebuild_ms;
+	uint32_t rebuilds;
+	uint64_t checksum;
+};
+
+uint64_t cost_checksum(const baseline::Grid& grid)
+{
+	uint64_t sum = 0;
+	for (const baseline::Node& n : grid.nodes)
+		sum = sum * 31 + n.cost;
+	return sum;
+}
+
+template <typename Queue>
+Result run(const GPPC::ScenarioLoader& scen, int repeats)
+{
+	Result res{};
+	GPPC::Timer timer;
+	for (int r = 0; r < repeats; ++r) {
+		GPPC::ScenarioRunner runner;
+		runner.linkScen(scen);
+		runner.nextQuery();
+		baseline::Grid grid(runner.getActiveMap());
+		Queue Q;
+		timer.StartTimer();
+		baseline::setup_grid(grid, Q);
+		timer.EndTimer();
+		res.init_ms += timer.GetElapsedTime().count() * 1e-6;
+		for (int changes; (changes = runner.nextQuery()) >= 0; ) {
+			if (changes == 0)
+				continue;
+			const auto& patches = runner.getAppliedPatches();
+			grid.storage.update(grid.cells, patches.data(), static_cast<uint32_t>(patches.size()));
+			timer.StartTimer();
+			baseline::setup_grid(grid, Q);
+			timer.EndTimer();
+			res.rebuild_ms += timer.GetElapsedTime().count() * 1e-6;
+			res.rebuilds++;
+		}
+		res.checksum = cost_checksum(grid);
+	}
+	res.init_ms /= repeats;
+	res.rebuild_ms /= repeats;
+	res.rebuilds /= repeats;
+	return res;
+}
+
+void print(const char* name, const Result& res)
+{
+	std::printf("%-12s init %9.3f ms  rebuild %9.3f ms (%u rebuilds, %.3f ms each)  checksum %016llx\n",
+		name, res.init_ms, res.rebuild_ms, res.rebuilds,
+		res.rebuilds != 0 ? res.rebuild_ms / res.rebuilds : 0.0,
+		static_cast<unsigned long long>(res.checksum));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::printf("Usage %s <scenario> [repeats]\n", argv[0]);
+		return 1;
+	}
+	int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+	GPPC::ScenarioLoader scen;
+	if (!scen.load(argv[1])) {
+		std::fprintf(stderr, "Failed to load scenario file: %s\n", argv[1]);
+		return 1;
+	}
+	std::printf("%s %dx%d, %d repeats\n", argv[1], scen.getWidth(), scen.getHeight(), repeats);
+	print("binary-heap", run<baseline::BinaryHeapQueue>(scen, repeats));
+	print("radix-heap", run<baseline::DijkstraQueue>(scen, repeats));
+	return 0;
+}
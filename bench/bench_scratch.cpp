@@ -0,0 +1,124 @@
+// Counts the heap allocations of SpanningTreeSearch on a scenario, by replacing the global operator new.
+// init: the constructor, trees built on the starting map, or in later passes update_grid() back on it.
+// rebuild / repair / unchanged: update_grid of each map change, by what the engine did with it.
+// search: every query, streamed parts included.
+// For each kind the first call is listed apart. Scratch buffers grow to the largest call seen, so later
+// passes over the scenario with the same engine should allocate nothing.
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "ScenarioLoader.h"
+#include "BaselineSearch.hxx"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+struct Count
+{
+	const char* name;
+	size_t calls = 0;
+	size_t first = 0; // allocations of the first call
+	size_t after = 0; // allocations of every later call
+	size_t allocating = 0; // later calls that allocated
+
+	template <typename Fn>
+	void measure(Fn&& fn)
+	{
+		size_t before = allocations.load();
+		fn();
+		add(allocations.load() - before);
+	}
+	void add(size_t n)
+	{
+		if (calls++ == 0) {
+			first = n;
+		} else {
+			after += n;
+			allocating += n != 0;
+		}
+	}
+	void print() const
+	{
+		std::printf("%-9s calls %6zu  first %6zu  after %6zu  in %zu calls\n", name, calls, first, after, allocating);
+	}
+};
+
+} // namespace
+
+void* operator new(size_t size)
+{
+	allocations++;
+	if (void* p = std::malloc(size != 0 ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::printf("Usage %s <scenario> [passes]\n", argv[0]);
+		return 1;
+	}
+	GPPC::ScenarioLoader scen;
+	if (!scen.load(argv[1])) {
+		std::fprintf(stderr, "Failed to load scenario file: %s\n", argv[1]);
+		return 1;
+	}
+	int passes = argc > 2 ? std::max(1, std::atoi(argv[2])) : 2;
+	std::printf("%s %dx%d\n", argv[1], scen.getWidth(), scen.getHeight());
+	std::vector<GPPC::ScenarioRunner> runners(passes);
+	baseline::SpanningTreeSearch* engine = nullptr;
+	for (int pass = 0; pass < passes; ++pass) {
+		GPPC::ScenarioRunner& runner = runners[pass];
+		runner.linkScen(scen);
+		runner.nextQuery();
+		Count init{"init"}, rebuild{"rebuild"}, repair{"repair"}, unchanged{"unchanged"}, search{"search"};
+		if (pass == 0) {
+			init.measure([&] { engine = new baseline::SpanningTreeSearch(runner.getActiveMap()); });
+			engine->stream_prefix = true;
+		} else {
+			// same engine on the starting map again
+			engine->cells = runner.getActiveMap();
+			engine->storage.load(engine->cells);
+			engine->shadow.load(engine->cells);
+			init.measure([&] { engine->update_grid(); });
+		}
+		for (int changes = 0; changes >= 0; changes = runner.nextQuery()) {
+			if (changes > 0) {
+				const auto& patches = runner.getAppliedPatches();
+				size_t before = allocations.load(), repairs = engine->repairs, rebuilds = engine->rebuilds;
+				engine->update_grid(patches.data(), static_cast<uint32_t>(patches.size()));
+				size_t n = allocations.load() - before;
+				(engine->repairs != repairs ? repair : engine->rebuilds != rebuilds ? rebuild : unchanged).add(n);
+			}
+			auto q = runner.getCurrentQuery();
+			search.measure([&] {
+				baseline::Point s(q.start.x, q.start.y), g(q.goal.x, q.goal.y);
+				while (engine->search(s, g) && engine->incomplete())
+					;
+			});
+		}
+		std::printf("pass %d\n", pass + 1);
+		init.print();
+		rebuild.print();
+		repair.print();
+		unchanged.print();
+		search.print();
+	}
+	delete engine;
+	return 0;
+}
@@ -0,0 +1,99 @@
+// Compares the cell storage policies of BasicGrid on a scenario map.
+// dijkstra: a tree from every unreached open cell of the starting map, in expansions per second.
+// astar: every query of the scenario with BasicAStarSearch, the map changed between them as the scenario says.
+// update: the storage update of every map change, total.
+// Results are checked against the BitarrayCells run by a cost checksum and the summed path lengths.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "ScenarioLoader.h"
+#include "Timer.h"
+#include "BaselineSearch.hxx"
+#include "AStarSearch.hxx"
+
+namespace {
+
+struct Result
+{
+	double dijkstra_ms;
+	uint64_t expansions;
+	uint64_t checksum;
+	double astar_ms;
+	double update_ms;
+	uint64_t path_cells;
+};
+
+template <typename Cells>
+Result run(const GPPC::ScenarioLoader& scen)
+{
+	using baseline::Node;
+	Result res{};
+	GPPC::Timer timer;
+	GPPC::ScenarioRunner runner;
+	runner.linkScen(scen);
+	runner.nextQuery();
+	{
+		baseline::BasicGrid<Cells> grid(runner.getActiveMap());
+		grid.nodes.assign(grid.size(), Node{Node::INV, Node::INV});
+		baseline::DijkstraQueue Q;
+		timer.StartTimer();
+		for (uint32_t origin = 0; origin < grid.size(); ++origin) {
+			if (grid.get_unbound(origin) && grid.nodes[origin].cost == Node::INV)
+				baseline::dijkstra(grid, Q, origin);
+		}
+		timer.EndTimer();
+		res.dijkstra_ms = timer.GetElapsedTime().count() * 1e-6;
+		for (const Node& n : grid.nodes) {
+			res.checksum = res.checksum * 31 + n.cost;
+			res.expansions += n.cost != Node::INV;
+		}
+	}
+	baseline::BasicAStarSearch<Cells> astar(runner.getActiveMap());
+	for (int changes = 0; changes >= 0; changes = runner.nextQuery()) {
+		if (changes > 0) {
+			const auto& patches = runner.getAppliedPatches();
+			timer.StartTimer();
+			astar.update_grid(patches.data(), static_cast<uint32_t>(patches.size()));
+			timer.EndTimer();
+			res.update_ms += timer.GetElapsedTime().count() * 1e-6;
+		}
+		auto q = runner.getCurrentQuery();
+		timer.StartTimer();
+		astar.search(baseline::Point(q.start.x, q.start.y), baseline::Point(q.goal.x, q.goal.y));
+		timer.EndTimer();
+		res.astar_ms += timer.GetElapsedTime().count() * 1e-6;
+		res.path_cells += astar.get_path().size();
+	}
+	return res;
+}
+
+void print(const char* name, const Result& res, const Result& ref)
+{
+	std::printf("%-9s dijkstra %7.2f M/s  astar %9.3f ms  update %7.3f ms  %s\n",
+		name, res.expansions / (res.dijkstra_ms * 1e3), res.astar_ms, res.update_ms,
+		res.checksum == ref.checksum && res.path_cells == ref.path_cells ? "same" : "MISMATCH");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::printf("Usage %s <scenario>\n", argv[0]);
+		return 1;
+	}
+	GPPC::ScenarioLoader scen;
+	if (!scen.load(argv[1])) {
+		std::fprintf(stderr, "Failed to load scenario file: %s\n", argv[1]);
+		return 1;
+	}
+	std::printf("%s %dx%d\n", argv[1], scen.getWidth(), scen.getHeight());
+	Result ref = run<baseline::BitarrayCells>(scen);
+	print("bitarray", ref, ref);
+	print("padded", run<baseline::PaddedMap>(scen), ref);
+	print("byte", run<baseline::ByteCells>(scen), ref);
+	print("tiled", run<baseline::TiledCells>(scen), ref);
+	return 0;
+}
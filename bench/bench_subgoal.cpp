@@ -0,0 +1,43 @@
+// Runs SubgoalGraphSearch and BasicAStarSearch through a scenario, map changes included.
+// build: the subgoal graph of the starting map. update: update_grid of every map change, against a full
+// build of the changed map. query: every query of the scenario, mean and slowest.
+// Path costs are checked against A*, which is optimal.
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include "BenchScenario.hxx"
+#include "AStarSearch.hxx"
+#include "SubgoalGraphSearch.hxx"
+
+int main(int argc, char** argv)
+{
+	GPPC::ScenarioLoader scen;
+	if (!bench::load_scenario(argc, argv, scen))
+		return 1;
+	bench::ScenarioSteps steps(scen);
+	bench::Times build, update, rebuild, query, astar_query;
+	std::unique_ptr<baseline::SubgoalGraphSearch> ssg;
+	build.add(bench::time_ms([&] { ssg.reset(new baseline::SubgoalGraphSearch(steps.map())); }));
+	baseline::AStarSearch astar(steps.map());
+	size_t mismatches = 0;
+	steps.run([&] (const gppc_patch* changes, uint32_t changes_length) {
+		update.add(bench::time_ms([&] { ssg->update_grid(changes, changes_length); }));
+		astar.update_grid(changes, changes_length);
+		rebuild.add(bench::time_ms([&] { baseline::SubgoalGraphSearch fresh(steps.map()); }));
+	}, [&] (baseline::Point s, baseline::Point g) {
+		bool found = false, astar_found = false;
+		query.add(bench::time_ms([&] { found = ssg->search(s, g); }));
+		astar_query.add(bench::time_ms([&] { astar_found = astar.search(s, g); }));
+		if (found != astar_found || bench::path_cost(ssg->get_path()) != bench::path_cost(astar.get_path()))
+			mismatches++;
+	});
+	build.print("build");
+	update.print("update");
+	rebuild.print("rebuild");
+	query.print("query");
+	astar_query.print("astar");
+	ssg->print_stats(std::cout);
+	std::printf("%zu path costs differ from A*\n", mismatches);
+	return mismatches != 0;
+}